@@ -21,6 +21,7 @@
 #include <ti/sysbios/knl/Task.h>
 #include <ti/sysbios/knl/Event.h>
 #include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/knl/Semaphore.h>
 #include <ti/sysbios/gates/GateMutexPri.h>
 
 /* Board Header files */
@@ -42,6 +43,18 @@ extern "C" {
 #include "lpmac_types.h"
 #include "lpmac_config.h"
 #include "lpmac_neighbors.h"
+#include "lpmac_routes.h"
+#include "lpmac_channels.h"
+#include "lpmac_lpl.h"
+#include "lpmac_tdma.h"
+#include "lpmac_txq.h"
+#include "lpmac_stats.h"
+#include "lpmac_trace.h"
+#include "lpmac_energy.h"
+#include "lpmac_rxq.h"
+#include "lpmac_timers.h"
+#include "lpmac_compress.h"
+#include "lpmac_bcast.h"
 #include "lpmac.h"
 
 #include <Board.h>
@@ -55,12 +68,28 @@ extern "C" {
 //#define RX_TIMEOUT_VALUE                            5000
 //#define RX_TIMEOUT_VALUE                            1000
 #define RX_TIMEOUT_VALUE                            0
+#ifdef LPL_ENABLED
+#define TX_TIMEOUT_VALUE                            (3000 + LPL_WAKE_INTERVAL_MS)
+#else
+#define TX_TIMEOUT_VALUE                            3000
+#endif
 #define BUFFER_SIZE                                 256 // Define the payload size here
 
+#ifdef LPL_ENABLED
+#define ACK_DATA_SIZE                               sizeof(lpl_stamp_t)
+#else
+#define ACK_DATA_SIZE                               0
+#endif
+
+#if defined( USE_MODEM_LORA )
+#define RADIO_MODEM                                 MODEM_LORA
+#elif defined( USE_MODEM_FSK )
+#define RADIO_MODEM                                 MODEM_FSK
+#endif
+
 // ---- RUNTIME ---- //
 
 const static struct Radio_s *radios;
-static rx_fn_t rx_fn;
 
 static Task_Params lpmacTaskParams;
 static Task_Struct lpmacTaskStruct;
@@ -75,8 +104,39 @@ static Event_Handle lpmacRequestEventsHandle;
 static GateMutexPri_Struct lpmacMutexStruct;
 static GateMutexPri_Handle lpmacMutexHandle;
 
-static Clock_Params timeoutParams;
-static Clock_Struct timeoutStruct;
+static lpmac_timer_t timeoutTimer;
+
+#ifdef MULTICHANNEL_ENABLED
+static lpmac_timer_t hopTimer;
+static uint8_t listen_channel;
+// The broadcast being repeated on the rendezvous channel, a copy per hop
+static uint8_t rdv_buf[BUFFER_SIZE];
+static size_t rdv_size;
+static unsigned rdv_copies; // Copies still to send
+#endif
+
+#ifdef LPL_ENABLED
+static lpmac_timer_t wakeTimer;
+static uint32_t answers_until; // Clock ticks until which we stay up for answers to a broadcast
+#endif
+
+#ifdef TDMA_ENABLED
+// Not on the timer wheel, which rounds up to whole wheel ticks
+static Clock_Params beaconParams;
+static Clock_Struct beaconStruct;
+#endif
+
+#ifdef RTSCTS_ENABLED
+static uint32_t nav_until;  // Clock ticks when the overheard reservation ends
+static uint32_t nav_max_ms; // The longest reservation we honor, set once the radio is configured
+#endif
+
+#ifdef MESH_ENABLED
+static lpmac_timer_t advertTimer;
+#endif
+
+static bool join_pending;   // Requested, but not sent yet
+static bool advert_pending; // Routes due to be re-advertised, without asking for ACKs
 
 static uint16_t BufferSize = 0;
 static uint8_t Buffer[BUFFER_SIZE];
@@ -88,28 +148,127 @@ static uint8_t next_pkt_id = 0;
 static pkt_hdr_t *outgoing_hdr;
 static uint8_t *outgoing_buf;
 static int outgoing_retries;
+static int outgoing_busy;     // Resends because the receiver answered busy
+static bool outgoing_backoff; // The next timeout resends to a busy receiver
+static txq_entry_t *outgoing_entry;
+#ifdef BCAST_ENABLED
+static uint8_t bcast_buf[BUFFER_SIZE]; // Payload of the reliable broadcast frame being sent
+#endif
+#ifdef COMPRESS_ENABLED
+static uint8_t compress_buf[BUFFER_SIZE];
+static size_t outgoing_plain_size; // The DATA payload size before compression
+#endif
+
+#ifdef MESH_ENABLED
+// Mesh packet waiting to be forwarded to the next hop
+static uint8_t forward_buf[BUFFER_SIZE];
+static txq_entry_t forward_entry;
+static bool forward_pending;
+#endif
 
 static uint8_t outgoing_ack_hdr_buf[PKT_HDR_CALC_SIZE(1)];
 static pkt_hdr_t *outgoing_ack_hdr = (pkt_hdr_t *) &outgoing_ack_hdr_buf;
 
 static int8_t RssiValue = 0;
 static int8_t SnrValue = 0;
+static uint32_t RxTicks = 0;
 
 /*!
  * Radio events function pointer
  */
 static RadioEvents_t RadioEvents;
 
+/*
+ * Radio state changes go through these, so the trace and the
+ * energy accounting see every one of them
+ */
+
+static void radio_sleep() {
+	lpmac_trace(TRACE_STATE, TRACE_STATE_SLEEP, 0);
+	lpmac_energy_state(LPMAC_RADIO_SLEEP);
+	radios->Sleep();
+}
+
+static void radio_standby() {
+	lpmac_trace(TRACE_STATE, TRACE_STATE_STANDBY, 0);
+	lpmac_energy_state(LPMAC_RADIO_STANDBY);
+	radios->Standby();
+}
+
+static void radio_rx(uint32_t timeout) {
+	lpmac_trace(TRACE_STATE, TRACE_STATE_RX, 0);
+	lpmac_energy_state(LPMAC_RADIO_RX);
+	radios->Rx(timeout);
+}
+
+static void radio_cad() {
+	lpmac_trace(TRACE_CAD_START, 0, 0);
+	lpmac_energy_state(LPMAC_RADIO_CAD);
+	radios->StartCad();
+}
+
+static void radio_send(uint8_t *buf, size_t size) {
+	const pkt_hdr_t *hdr = (const pkt_hdr_t *) buf;
+	lpmac_trace_frame(TRACE_TX_START, buf, size, 0, 0);
+	lpmac_energy_tx((hdr->dst_count > 0) ? hdr->dst[0] : 0);
+	radios->Send(buf, size);
+}
+
+/*!
+ * \brief Note that single receive mode leaves the radio in standby
+ */
+static inline void radio_rx_ended() {
+#ifdef LPL_ENABLED
+	lpmac_energy_state(LPMAC_RADIO_STANDBY);
+#endif
+}
+
 /*!
  * \brief Function to be executed on Radio Tx Done event
  */
 static void OnTxDone(void) {
 	printf("OnTxDone\n");
-	radios->Sleep();
+	lpmac_trace(TRACE_TX_DONE, 0, 0);
+	radio_sleep();
 //    radios->Standby();
 	Event_post(lpmacEventsHandle, EVENT_TXDONE);
 }
 
+#ifdef RTSCTS_ENABLED
+/**
+ * Extend the NAV, our virtual carrier sense, by an overheard reservation
+ */
+static void nav_set(uint32_t duration_ms) {
+	uint32_t until;
+	// A corrupted or misread duration must not silence us for long
+	if (duration_ms > nav_max_ms) {
+		duration_ms = nav_max_ms;
+	}
+	until = Clock_getTicks() + (duration_ms * TIME_MS);
+	if ((int32_t) (until - nav_until) > 0) {
+		nav_until = until;
+	}
+}
+
+/**
+ * @return The time in ms until the medium is no longer reserved
+ */
+static uint32_t nav_remaining() {
+	int32_t remaining = (int32_t) (nav_until - Clock_getTicks());
+	return (remaining > 0) ? ((uint32_t) remaining / TIME_MS) : 0;
+}
+#endif
+
+/*!
+ * \brief Let the task put the radio back to listening after dropping a packet
+ */
+static inline void rx_dropped() {
+#ifdef LPL_ENABLED
+	// Single receive mode leaves the radio in standby
+	Event_post(lpmacEventsHandle, EVENT_RXERROR);
+#endif
+}
+
 /*!
  * \brief Function to be executed on Radio Rx Done event
  */
@@ -120,12 +279,17 @@ static void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 	dprintf("OnRxDone - RSSI=%d, SNR=%d\n", rssi, snr);
 	hexdump(payload, size);
 	uarthexdump(payload, size);
+	lpmac_trace_frame(TRACE_RX, payload, size, rssi, snr);
+	radio_rx_ended();
 
 	if (size < PKT_HDR_CALC_SIZE(0)) {
 		dprintf("Received a packet(%u) that was smaller than a header(%u)\n",
 				size, PKT_HDR_CALC_SIZE(0));
 //    	radios->Rx(0);
 		// Do not process this message
+		lpmac_stats_add(LPMAC_STAT_DROP_RUNT, 1);
+		lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_RUNT, 0);
+		rx_dropped();
 		return;
 	}
 	if (PKT_SIZE(hdr) != size) {
@@ -134,12 +298,33 @@ static void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 				PKT_SIZE(hdr), size);
 //    	radios->Rx(0);
 		// Do not process this message
+		lpmac_stats_add(LPMAC_STAT_DROP_SIZE, 1);
+		lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_SIZE, 0);
+		rx_dropped();
 		return;
 	}
+	lpmac_stats_add(LPMAC_STAT_RX_FRAMES, 1);
+	lpmac_stats_add(LPMAC_STAT_RX_BYTES, size);
+	lpmac_stats_neighbor_rx(hdr->src, rssi);
 
     // This heard must be before the following Event_post, since it may remove this neighbor
     lpmac_neighbors_heard(hdr->src, rssi);
 
+#	ifdef RTSCTS_ENABLED
+	if ((hdr->pkt_type == PKT_TYPE_RTS || hdr->pkt_type == PKT_TYPE_CTS)
+			&& hdr->dst_count == 1 && hdr->data_size >= sizeof(rts_duration_t)) {
+		if (hdr->dst[0] != myid) {
+			// Someone else reserved the medium
+			rts_duration_t duration;
+			memcpy(&duration, PKT_DATA_PTR(hdr), sizeof(duration));
+			nav_set(duration);
+		} else if (hdr->pkt_type == PKT_TYPE_CTS && outgoing_hdr
+				&& outgoing_hdr->pkt_id == hdr->pkt_id) {
+			Event_post(lpmacEventsHandle, EVENT_CTS);
+		}
+	}
+#	endif
+
 #	ifdef ID_FILTER_ENABLED
 	{
 		uint8_t index;
@@ -152,6 +337,9 @@ static void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 		if (hdr->dst_count != 0 && index == hdr->dst_count) {
 			// Do not process this message
 			dprintf("Dropping pkt from %8.8X for dst[0] = 0x%8.8X\n", hdr->src, hdr->dst[0]);
+			lpmac_stats_add(LPMAC_STAT_DROP_FILTER, 1);
+			lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_FILTER, 0);
+			rx_dropped();
 			return;
 		}
 	}
@@ -162,6 +350,7 @@ static void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
 	memcpy(Buffer, payload, BufferSize);
 	RssiValue = rssi;
 	SnrValue = snr;
+	RxTicks = Clock_getTicks();
 //    radios->Rx(0);
 
 	Event_post(lpmacEventsHandle, EVENT_RXDONE);
@@ -172,7 +361,9 @@ static void OnRxDone(uint8_t *payload, uint16_t size, int16_t rssi, int8_t snr)
  */
 static void OnTxTimeout(void) {
 	dprintf("OnTxTimeout\n");
-	radios->Sleep();
+	lpmac_stats_add(LPMAC_STAT_TX_TIMEOUTS, 1);
+	lpmac_trace(TRACE_TX_DONE, 1, 0);
+	radio_sleep();
 //    radios->Standby();
 	Event_post(lpmacEventsHandle, EVENT_TXTIMEOUT);
 }
@@ -182,6 +373,8 @@ static void OnTxTimeout(void) {
  */
 static void OnRxTimeout(void) {
 	dprintf("OnRxTimeout\n");
+	lpmac_trace(TRACE_RX_TIMEOUT, 0, 0);
+	radio_rx_ended();
 //    radios->Sleep( );
 //    radios->Standby();
 	Event_post(lpmacEventsHandle, EVENT_RXTIMEOUT);
@@ -192,6 +385,9 @@ static void OnRxTimeout(void) {
  */
 static void OnRxError(void) {
 	dprintf("OnRxError\n");
+	lpmac_stats_add(LPMAC_STAT_DROP_CRC, 1);
+	lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_CRC, 0);
+	radio_rx_ended();
 //    radios->Sleep( );
 //    radios->Standby();
 	Event_post(lpmacEventsHandle, EVENT_RXERROR);
@@ -205,7 +401,8 @@ static void OnRxError(void) {
 static void OnCadDone( bool channelActivityDetected) {
 	dprintf("OnCadDone - %s\n",
 			channelActivityDetected ? "Detected" : "NotDetected");
-	radios->Sleep();
+	lpmac_trace(TRACE_CAD_DONE, channelActivityDetected, 0);
+	radio_sleep();
 //    radios->Standby();
 	UInt event =
 			channelActivityDetected ?
@@ -219,6 +416,10 @@ static inline node_id_t getmyid() {
 	return (node_id_t) (id & 0xFFFFFFFF);
 }
 
+static void neighbors_pending() {
+	Event_post(lpmacEventsHandle, EVENT_NEIGHBORS);
+}
+
 static void clearevents(UInt events) {
 	if (Event_getPostedEvents(lpmacEventsHandle) & events) {
 		Event_pend(lpmacEventsHandle, Event_Id_NONE, events, BIOS_WAIT_FOREVER);
@@ -230,52 +431,163 @@ Void timeout_callback(UArg arg) {
 }
 
 static void timeout_init() {
-	Clock_Params_init(&timeoutParams);
-	timeoutParams.period = 0;
-	timeoutParams.startFlag = FALSE;
-	Clock_construct(&timeoutStruct, timeout_callback, 0, &timeoutParams);
+	lpmac_timer_init(&timeoutTimer, timeout_callback, 0);
 }
 
 static void timeout_start(uint32_t ms) {
-	Clock_setTimeout(Clock_handle(&timeoutStruct), (UInt32) (ms * TIME_MS));
-	Clock_start( Clock_handle(&timeoutStruct));
+	lpmac_timer_start(&timeoutTimer, ms, 0);
 }
 
 static void timeout_stop() {
-	Clock_stop( Clock_handle(&timeoutStruct));
+	lpmac_timer_stop(&timeoutTimer);
+}
+
+#ifdef MULTICHANNEL_ENABLED
+Void hop_callback(UArg arg) {
+	Event_post(lpmacEventsHandle, EVENT_HOP);
+}
+
+static void hop_init() {
+	lpmac_timer_init(&hopTimer, hop_callback, 0);
+}
+#endif
+
+#ifdef LPL_ENABLED
+Void wake_callback(UArg arg) {
+	Event_post(lpmacEventsHandle, EVENT_WAKE);
+}
+
+static void wake_init() {
+	lpmac_timer_init(&wakeTimer, wake_callback, 0);
+}
+#endif
+
+#ifdef MESH_ENABLED
+Void advert_callback(UArg arg) {
+	Event_post(lpmacEventsHandle, EVENT_ADVERT);
+}
+
+static void advert_init() {
+	lpmac_timer_init(&advertTimer, advert_callback, 0);
 }
 
 /**
- * Send using Listen Before Talk with random backoff times.
+ * Restart the route advertisement timer. The period is jittered, so that
+ * neighbors that started together do not keep advertising at once.
+ */
+static void advert_start() {
+	uint32_t jitter = ((ROUTES_ADVERT_MS / 2) / 256) * (((uint32_t) rand() >> 7) & 0xFF);
+	lpmac_timer_start(&advertTimer, ROUTES_ADVERT_MS - (ROUTES_ADVERT_MS / 4) + jitter, 0);
+}
+#endif
+
+#ifdef TDMA_ENABLED
+Void beacon_callback(UArg arg) {
+	Event_post(lpmacEventsHandle, EVENT_BEACON);
+}
+
+static void beacon_init() {
+	Clock_Params_init(&beaconParams);
+	beaconParams.period = 0;
+	beaconParams.startFlag = FALSE;
+	Clock_construct(&beaconStruct, beacon_callback, 0, &beaconParams);
+}
+
+/**
+ * Restart the beacon clock, since the superframe grows with each new member
+ */
+static void beacon_start(uint32_t superframe_ms) {
+	Clock_stop(Clock_handle(&beaconStruct));
+	Clock_setTimeout(Clock_handle(&beaconStruct), (UInt32) (superframe_ms * TIME_MS));
+	Clock_start(Clock_handle(&beaconStruct));
+}
+#endif
+
+#if defined( USE_MODEM_LORA )
+static void tx_config(uint16_t preamble) {
+	radios->SetTxConfig(MODEM_LORA, TX_OUTPUT_POWER, 0, LORA_BANDWIDTH,
+	LORA_SPREADING_FACTOR,
+	LORA_CODINGRATE,
+	preamble,
+	LORA_FIX_LENGTH_PAYLOAD_ON,
+	true, 0, 0, LORA_IQ_INVERSION_ON, TX_TIMEOUT_VALUE);
+}
+#endif
+
+/**
+ * Put the radio back into receive on our current listen channel.
+ * While waiting for an ACK, or for answers to a broadcast we are still
+ * repeating, we always listen on our home channel.
+ * With low power listening, the radio sleeps until the next wake up
+ * unless we are waiting for an ACK or for answers to a broadcast.
+ */
+static void listen() {
+#ifdef MULTICHANNEL_ENABLED
+	uint8_t channel = listen_channel;
+	if (outgoing_hdr != NULL || rdv_copies > 0) {
+		channel = lpmac_channels_home(myid);
+	}
+	radios->SetChannel(lpmac_channels_freq(channel));
+#endif
+#ifdef LPL_ENABLED
+	int32_t answers = (int32_t) (answers_until - Clock_getTicks());
+	if (outgoing_hdr != NULL) {
+		radio_rx(RETRIES_TIMEOUT_MS);
+	} else if (answers >= (int32_t) TIME_MS) {
+		// Answers come with a short preamble, so they need us up
+		radio_rx((uint32_t) answers / TIME_MS);
+	} else {
+		radio_sleep();
+	}
+#else
+	radio_rx(RX_TIMEOUT_VALUE);
+#endif
+}
+
+/**
+ * @return true if hdr is a broadcast that neighbors answer, spread over
+ *         ANSWER_SPREAD_MS
+ */
+static inline bool wants_answers(const pkt_hdr_t *hdr) {
+	return (hdr->dst_count == 0) && ((hdr->pkt_opts & PKT_OPTIONS_REQ_ACK)
+			|| (hdr->pkt_type == PKT_TYPE_BCAST_POLL));
+}
+
+/**
+ * Transmit a raw packet using Listen Before Talk with random backoff times.
  * This blocks until the transmission is finished.
  *
- * @param hdr Pointer to a packet header
- * @param data Pointer to data buffer, can be NULL
- * @param data_size Size of data buffer, can be 0
+ * @param buf The complete packet
+ * @param size Size of the packet
+ */
+/*!
+ * \brief TDMA beacons own the start of the superframe, they are sent without backoff
  */
-static void send(const pkt_hdr_t *hdr, char *data) {
+static inline bool lbt_exempt(const pkt_hdr_t *hdr) {
+#ifdef TDMA_ENABLED
+	return hdr->pkt_type == PKT_TYPE_BEACON;
+#else
+	(void) hdr;
+	return false;
+#endif
+}
+
+static void transmit(uint8_t *buf, size_t size) {
+	const pkt_hdr_t *hdr = (const pkt_hdr_t *) buf;
 	UInt events;
 	int delay;
-	uint8_t *buf = (uint8_t *) malloc(PKT_SIZE(hdr));
-	if (buf == NULL) {
-		rerror("Failed to allocate send buffer\n");
-	}
-	memcpy(buf, hdr, PKT_HDR_SIZE(hdr));
-	if ((data != NULL) && (hdr->data_size > 0)) {
-		memcpy(PKT_DATA_PTR((pkt_hdr_t * )buf), data, hdr->data_size);
-	}
-
-	delay = 10 * (rand() % 100);
-	dprintf("delaying %dms\n", delay);
-	Task_sleep(TIME_MS * delay);
+	uint32_t airtime;
+#ifdef LBT_ENABLED
+	uint32_t cad_start = Clock_getTicks();
+#endif
 
 //    radios->Sleep();
-	radios->Standby();
+	radio_standby();
 
 #ifdef LBT_ENABLED
-	do {
+	while (!lbt_exempt(hdr)) {
 		dprintf("CAD - Starting\n");
-		radios->StartCad();
+		radio_cad();
 //		dprintf("CAD - Started\n");
 		events = Event_pend(lpmacEventsHandle, Event_Id_NONE,
 				EVENT_CADDONE_DETECT | EVENT_CADDONE_NODETECT,
@@ -283,27 +595,464 @@ static void send(const pkt_hdr_t *hdr, char *data) {
 		if (events & EVENT_CADDONE_DETECT) {
 			delay = (rand() % 20) * 100;
 			dprintf("CAD - Activity Detected - Backoff %d ms\n", delay);
+			lpmac_stats_add(LPMAC_STAT_CAD_BUSY, 1);
+			lpmac_trace(TRACE_BACKOFF, delay, 0);
 			Task_sleep(delay * TIME_MS);
 		} else {
 			dprintf("CAD - Clear\n");
 			break;
 		}
-	} while (1);
+	}
+	lpmac_stats_sample(LPMAC_HIST_CAD_WAIT, (Clock_getTicks() - cad_start) / TIME_MS);
+#endif
+
+#ifdef LPL_ENABLED
+	if (hdr->pkt_type == PKT_TYPE_ACK && hdr->data_size >= sizeof(lpl_stamp_t)) {
+		// Stamp our wake phase after any backoff, as the frame starts
+		lpl_stamp_t stamp = lpmac_lpl_stamp();
+		memcpy(PKT_DATA_PTR((pkt_hdr_t * )buf), &stamp, sizeof(stamp));
+	}
 #endif
 
+	airtime = radios->TimeOnAir(RADIO_MODEM, size);
+	lpmac_stats_add(LPMAC_STAT_TX_FRAMES, 1);
+	lpmac_stats_add(LPMAC_STAT_TX_BYTES, size);
+	lpmac_stats_add(LPMAC_STAT_TX_AIRTIME_MS, airtime);
+	if (hdr->dst_count > 0) {
+		lpmac_stats_neighbor_add(hdr->dst[0], STATS_NEIGHBOR_TX_AIRTIME_MS, airtime);
+	}
+
 	dprintf("Firing Message\n");
-	hexdump(buf, PKT_SIZE(hdr));
-	uarthexdump(buf, PKT_SIZE(hdr));
-	radios->Send(buf, PKT_SIZE(hdr));
-	free(buf);
+	hexdump(buf, size);
+	uarthexdump(buf, size);
+	radio_send(buf, size);
+#ifdef TDMA_ENABLED
+	if (hdr->pkt_type == PKT_TYPE_BEACON) {
+		// Members time the superframe from the start of the beacon on air
+		lpmac_tdma_beacon_sent(Clock_getTicks());
+	}
+#endif
 	events = Event_pend(lpmacEventsHandle, Event_Id_NONE,
 			EVENT_TXDONE | EVENT_TXTIMEOUT, BIOS_WAIT_FOREVER);
 	if (events & EVENT_TXTIMEOUT) {
 		dprintf("Received a TXTIMEOUT\n");
 //        rerror("Received a TXTIMEOUT\n");
 	}
+#ifdef LPL_ENABLED
+	if (wants_answers(hdr)) {
+		answers_until = Clock_getTicks() + (LPL_ANSWER_WINDOW_MS * TIME_MS);
+	}
+#endif
+}
+
+/**
+ * @return true if the packet answers another packet and must go out promptly
+ */
+static inline bool is_response(const pkt_hdr_t *hdr) {
+	return (hdr->pkt_type == PKT_TYPE_ACK) || (hdr->pkt_type == PKT_TYPE_CTS);
+}
+
+/**
+ * Tune the radio to the channel that reaches the packet's destination.
+ *
+ * @return The number of copies of the packet to transmit
+ */
+static unsigned tune(const pkt_hdr_t *hdr) {
+#ifdef MULTICHANNEL_ENABLED
+	bool broadcast = (hdr->dst_count == 0);
+	uint8_t channel = lpmac_channels_dst(broadcast ? 0 : hdr->dst[0], broadcast);
+	dprintf("Set channel to %u\n", channel);
+	radios->SetChannel(lpmac_channels_freq(channel));
+	if (broadcast) {
+		// Repeat over one rendezvous period, so that every node's
+		// visit to the rendezvous channel overlaps one copy. The first
+		// copy is off the hop grid, so it takes one more to close the gap.
+		return CHANNEL_RDV_SLOTS + 1;
+	}
+#endif
+	return 1;
+}
+
+#ifdef RTSCTS_ENABLED
+/**
+ * @return The time in ms to reserve the medium for an exchange of a data
+ *         packet of size bytes
+ */
+static uint32_t rts_exchange_ms(size_t size) {
+	return radios->TimeOnAir(RADIO_MODEM, PKT_HDR_CALC_SIZE(1) + sizeof(rts_duration_t))
+			+ radios->TimeOnAir(RADIO_MODEM, size)
+			+ radios->TimeOnAir(RADIO_MODEM, PKT_HDR_CALC_SIZE(1) + ACK_DATA_SIZE)
+			+ (3 * RTS_TURNAROUND_MS);
+}
+
+static uint32_t rts_duration(const pkt_hdr_t *hdr) {
+	return rts_exchange_ms(PKT_SIZE(hdr));
+}
+
+/**
+ * Reserve the medium for a large packet with an RTS/CTS exchange.
+ *
+ * @param hdr The data packet we want to send
+ * @return true if the destination answered with a CTS
+ */
+static bool rts_exchange(const pkt_hdr_t *hdr) {
+	uint8_t rts_buf[PKT_HDR_CALC_SIZE(1) + sizeof(rts_duration_t)];
+	pkt_hdr_t *rts = (pkt_hdr_t *) rts_buf;
+	rts_duration_t duration = (rts_duration_t) rts_duration(hdr);
+	UInt events;
+
+	rts->pkt_type = PKT_TYPE_RTS;
+	rts->pkt_opts = PKT_OPTIONS_NO_ACK;
+	rts->pkt_id = hdr->pkt_id; // The CTS must match our pending packet
+	rts->dst_count = 1;
+	rts->data_size = sizeof(rts_duration_t);
+	rts->src = myid;
+	rts->dst[0] = hdr->dst[0];
+	memcpy(PKT_DATA_PTR(rts), &duration, sizeof(duration));
+
+	clearevents(EVENT_CTS);
+	dprintf("RTS - Reserving %u ms\n", duration);
+	transmit(rts_buf, PKT_SIZE(rts));
+	listen();
+	events = Event_pend(lpmacEventsHandle, Event_Id_NONE, EVENT_CTS,
+			CTS_TIMEOUT_MS * TIME_MS);
+	return (events & EVENT_CTS) != 0;
+}
+#endif
+
+/**
+ * Send using Listen Before Talk with random backoff times.
+ * This blocks until the transmission is finished.
+ *
+ * @param hdr Pointer to a packet header
+ * @param data Pointer to data buffer, can be NULL
+ * @param backoff Wait a random time first, to spread out answers to a broadcast
+ */
+static void send(const pkt_hdr_t *hdr, char *data, bool backoff) {
+	int delay;
+	unsigned copies;
+#ifdef LPL_ENABLED
+	// Responses go to a node that is awake, waiting for an ACK or for answers
+	uint16_t preamble = LORA_PREAMBLE_LENGTH;
+#endif
+	uint8_t *buf = (uint8_t *) malloc(PKT_SIZE(hdr));
+	if (buf == NULL) {
+		rerror("Failed to allocate send buffer\n");
+	}
+	memcpy(buf, hdr, PKT_HDR_SIZE(hdr));
+	if ((data != NULL) && (hdr->data_size > 0)) {
+		memcpy(PKT_DATA_PTR((pkt_hdr_t * )buf), data, hdr->data_size);
+	}
+
+	delay = backoff ? 10 * (rand() % (ANSWER_SPREAD_MS / 10)) : 0;
+#ifdef LPL_ENABLED
+	if (!is_response(hdr)) {
+		if (hdr->dst_count == 0) {
+			preamble = lpmac_lpl_preamble_long();
+		} else {
+			// Aim for the destination's wake up, if we know it
+			uint32_t wait = delay;
+			preamble = lpmac_lpl_schedule(hdr->dst[0], &wait);
+			delay = wait;
+		}
+	}
+#endif
+#ifdef TDMA_ENABLED
+	if (is_response(hdr) || hdr->pkt_type == PKT_TYPE_BEACON) {
+		// Responses answer inside the sender's slot, beacons own slot 0
+		delay = 0;
+	} else {
+		uint32_t wait;
+		uint32_t airtime = radios->TimeOnAir(RADIO_MODEM, PKT_SIZE(hdr))
+				+ radios->TimeOnAir(RADIO_MODEM, PKT_HDR_CALC_SIZE(1));
+		if (lpmac_tdma_wait(myid, airtime, &wait)) {
+			delay = wait;
+		}
+	}
+#endif
+	dprintf("delaying %dms\n", delay);
+	if (delay > 0) {
+		lpmac_trace(TRACE_BACKOFF, delay, 0);
+	}
+	Task_sleep(TIME_MS * delay);
+
+#ifdef RTSCTS_ENABLED
+	if (!is_response(hdr)) {
+		// Defer while an overheard exchange holds the medium
+		uint32_t remaining;
+		while ((remaining = nav_remaining()) > 0) {
+			dprintf("NAV - Deferring %u ms\n", remaining);
+			Task_sleep(remaining * TIME_MS);
+		}
+	}
+#endif
+
+#ifdef LPL_ENABLED
+	dprintf("Preamble %u symbols\n", preamble);
+	tx_config(preamble);
+#endif
+
+	copies = tune(hdr);
+
+#ifdef RTSCTS_ENABLED
+	if ((hdr->pkt_type == PKT_TYPE_DATA) && (hdr->dst_count == 1)
+			&& (hdr->data_size > RTS_THRESHOLD)) {
+		if (!rts_exchange(hdr)) {
+			// The retransmission timeout will try again
+			dprintf("RTS - No CTS\n");
+			free(buf);
+			listen();
+			return;
+		}
+#		ifdef LPL_ENABLED
+		tx_config(LORA_PREAMBLE_LENGTH); // The destination is awake now
+#		endif
+		copies = tune(hdr);
+	}
+#endif
+
+	transmit(buf, PKT_SIZE(hdr));
+#	ifdef MULTICHANNEL_ENABLED
+	if (copies > 1) {
+		// The rest go out from the hop timer, so the MAC keeps running meanwhile
+		memcpy(rdv_buf, buf, PKT_SIZE(hdr));
+		rdv_size = PKT_SIZE(hdr);
+		rdv_copies = copies - 1;
+	}
+#	else
+	(void) copies;
+#	endif
+	free(buf);
 //    radios->Sleep();
-	radios->Rx(RX_TIMEOUT_VALUE);
+	listen();
+}
+
+/**
+ * @return true while a broadcast is still being repeated on the rendezvous
+ *         channel, which must finish before the next transaction starts
+ */
+static inline bool rdv_busy() {
+#ifdef MULTICHANNEL_ENABLED
+	return rdv_copies > 0;
+#else
+	return false;
+#endif
+}
+
+#ifdef MULTICHANNEL_ENABLED
+/**
+ * Send the next copy of the broadcast being repeated
+ */
+static void rdv_repeat() {
+	rdv_copies--;
+	dprintf("Repeat broadcast, %u copies left\n", rdv_copies);
+	radios->SetChannel(lpmac_channels_freq(CHANNEL_RDV));
+#	ifdef LPL_ENABLED
+	tx_config(lpmac_lpl_preamble_long());
+#	endif
+	transmit(rdv_buf, rdv_size);
+	listen();
+}
+#endif
+
+#ifdef MESH_ENABLED
+typedef enum {
+	FORWARD_QUEUED,   // Acknowledge it
+	FORWARD_BUSY,     // Answer busy, so the previous hop resends later
+	FORWARD_NO_ROUTE  // Withhold the ACK, so the previous hop looks for another
+} forward_result_t;
+
+/**
+ * Queue a received mesh packet to be forwarded toward its final destination.
+ * A packet we are too busy to forward is answered busy rather than left
+ * unacknowledged, so that congestion is not taken for a broken link.
+ *
+ * @param hdr The received packet
+ * @return How the previous hop should be answered
+ */
+static forward_result_t mesh_forward(const pkt_hdr_t *hdr) {
+	pkt_hdr_t *fwd = (pkt_hdr_t *) forward_buf;
+	pkt_mesh_ext_t *ext = PKT_MESH_EXT_PTR(hdr);
+	node_id_t next_hop;
+
+	if (forward_pending) {
+		dprintf("Forward buffer busy, dropping pkt from "PRINTF_FMT_NODE_ID"\n", ext->origin);
+		lpmac_stats_add(LPMAC_STAT_DROP_QUEUE_FULL, 1);
+		lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_QUEUE_FULL, 0);
+		return FORWARD_BUSY;
+	}
+	if (hdr->dst_count == 0 || ext->hops_left == 0) {
+		dprintf("Not forwarding pkt from "PRINTF_FMT_NODE_ID"\n", ext->origin);
+		lpmac_stats_add(LPMAC_STAT_DROP_NO_ROUTE, 1);
+		lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_NO_ROUTE, 0);
+		return FORWARD_NO_ROUTE;
+	}
+	next_hop = lpmac_routes_lookup(ext->final_dst);
+	if (next_hop == 0 || next_hop == hdr->src) {
+		dprintf("No route to "PRINTF_FMT_NODE_ID"\n", ext->final_dst);
+		lpmac_stats_add(LPMAC_STAT_DROP_NO_ROUTE, 1);
+		lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_NO_ROUTE, 0);
+		return FORWARD_NO_ROUTE;
+	}
+
+	fwd->pkt_type = hdr->pkt_type;
+	fwd->pkt_opts = PKT_OPTIONS_REQ_ACK | PKT_OPTIONS_MESH
+			| (hdr->pkt_opts & (PKT_OPTIONS_PRIO_MASK | PKT_OPTIONS_COMPRESSED));
+	fwd->dst_count = 1;
+	fwd->data_size = hdr->data_size;
+	fwd->src = myid;
+	fwd->dst[0] = next_hop;
+	*PKT_MESH_EXT_PTR(fwd) = *ext;
+	PKT_MESH_EXT_PTR(fwd)->hops_left--;
+	memcpy(PKT_DATA_PTR(fwd), PKT_DATA_PTR(hdr), hdr->data_size);
+
+	forward_entry.hdr = fwd;
+	forward_entry.buf = PKT_DATA_PTR(fwd);
+	forward_entry.priority = PKT_OPTIONS_PRIO(fwd->pkt_opts);
+	forward_entry.forward = true;
+	forward_entry.queued = Clock_getTicks();
+	if (!lpmac_txq_push(&forward_entry)) {
+		dprintf("Transmit queue full\n");
+		lpmac_stats_add(LPMAC_STAT_DROP_QUEUE_FULL, 1);
+		lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_QUEUE_FULL, 0);
+		return FORWARD_BUSY;
+	}
+	lpmac_stats_add(LPMAC_STAT_FORWARDED, 1);
+
+	dprintf("Forwarding pkt for "PRINTF_FMT_NODE_ID" via "PRINTF_FMT_NODE_ID"\n",
+			ext->final_dst, next_hop);
+	forward_pending = true;
+	return FORWARD_QUEUED;
+}
+#endif
+
+/**
+ * Finish the outgoing transaction and tell the requester how it went
+ */
+static void outgoing_done(bool ok) {
+	txq_entry_t *entry = outgoing_entry;
+	// Broadcasts have no destination to keep stats for
+	node_id_t dst = (outgoing_hdr->dst_count > 0) ? outgoing_hdr->dst[0] : 0;
+
+	lpmac_stats_sample(LPMAC_HIST_SEND_LATENCY,
+			(Clock_getTicks() - entry->queued) / TIME_MS);
+	if (ok) {
+		// Broadcasts complete once sent, they were never acknowledged
+		if (dst != 0 && (outgoing_hdr->pkt_opts & PKT_OPTIONS_REQ_ACK)) {
+			lpmac_stats_add(LPMAC_STAT_SEND_OK, 1);
+			lpmac_stats_sample(LPMAC_HIST_RETRIES, outgoing_retries);
+			lpmac_stats_neighbor_add(dst, STATS_NEIGHBOR_ACKED, 1);
+		}
+	} else {
+		lpmac_stats_add(LPMAC_STAT_SEND_FAIL, 1);
+		lpmac_stats_neighbor_add(dst, STATS_NEIGHBOR_FAILURES, 1);
+	}
+
+	lpmac_trace(TRACE_SEND_DONE, outgoing_hdr->pkt_id, ok);
+#	ifdef COMPRESS_ENABLED
+	if (!entry->forward && (outgoing_hdr->pkt_type == PKT_TYPE_DATA)
+			&& !(outgoing_hdr->pkt_opts & PKT_OPTIONS_MESH)) {
+		if (ok) {
+			lpmac_compress_acked(dst, entry->buf, outgoing_plain_size);
+		} else {
+			lpmac_compress_failed(dst);
+		}
+	}
+#	endif
+	outgoing_hdr = NULL;
+	outgoing_entry = NULL;
+	if (entry->forward) {
+#		ifdef MESH_ENABLED
+		forward_pending = false;
+#		endif
+	} else {
+		entry->ok = ok;
+		Semaphore_post(Semaphore_handle(&entry->done));
+	}
+}
+
+#ifdef COMPRESS_ENABLED
+/**
+ * Recode the outgoing DATA frame without our dictionary, in case the
+ * receiver lost its copy to a reboot or to other senders
+ */
+static void outgoing_drop_dict() {
+	pkt_compress_ext_t ext;
+	size_t size;
+	if (outgoing_buf != compress_buf) {
+		return;
+	}
+	memcpy(&ext, compress_buf, sizeof(ext));
+	if (ext.dict == 0) {
+		return;
+	}
+	size = lpmac_compress(outgoing_hdr->dst[0], outgoing_entry->buf,
+			outgoing_plain_size, compress_buf, sizeof(compress_buf), false);
+	if (size > 0) {
+		outgoing_hdr->data_size = size;
+	} else {
+		outgoing_hdr->pkt_opts &= ~PKT_OPTIONS_COMPRESSED;
+		outgoing_hdr->data_size = outgoing_plain_size;
+		outgoing_buf = outgoing_entry->buf;
+	}
+}
+#endif
+
+/**
+ * Start the next queued transaction if the MAC is free
+ */
+static void outgoing_next() {
+	if (outgoing_hdr != NULL || rdv_busy()) {
+		return;
+	}
+	outgoing_entry = lpmac_txq_pop();
+	if (outgoing_entry == NULL) {
+		return;
+	}
+	outgoing_hdr = outgoing_entry->hdr;
+	outgoing_buf = outgoing_entry->buf;
+
+	// Numbered when sent, so queued packets never share an ID with one in flight
+	outgoing_hdr->pkt_id = next_pkt_id++;
+#	ifdef MESH_ENABLED
+	if (!outgoing_entry->forward && (outgoing_hdr->pkt_opts & PKT_OPTIONS_MESH)) {
+		PKT_MESH_EXT_PTR(outgoing_hdr)->seq = outgoing_hdr->pkt_id;
+	}
+#	endif
+
+#	ifdef COMPRESS_ENABLED
+	// Compressed once, so resends match what the receiver may already have
+	outgoing_plain_size = outgoing_hdr->data_size;
+	if (!outgoing_entry->forward && (outgoing_hdr->pkt_type == PKT_TYPE_DATA)) {
+		// Only the next hop shares our dictionary
+		size_t size = lpmac_compress(outgoing_hdr->dst[0], outgoing_buf,
+				outgoing_hdr->data_size, compress_buf, sizeof(compress_buf),
+				!(outgoing_hdr->pkt_opts & PKT_OPTIONS_MESH));
+		if (size > 0) {
+			lpmac_stats_add(LPMAC_STAT_TX_COMPRESSED, 1);
+			lpmac_stats_add(LPMAC_STAT_TX_BYTES_SAVED, outgoing_hdr->data_size - size);
+			outgoing_hdr->pkt_opts |= PKT_OPTIONS_COMPRESSED;
+			outgoing_hdr->data_size = size;
+			outgoing_buf = compress_buf;
+		}
+	}
+#	endif
+
+	dprintf("Send Started (priority %d)\n", outgoing_entry->priority);
+	if (outgoing_hdr->dst_count > 0) {
+		lpmac_stats_neighbor_add(outgoing_hdr->dst[0], STATS_NEIGHBOR_TX_FRAMES, 1);
+	}
+	lpmac_trace(TRACE_SEND_START, outgoing_hdr->pkt_id, outgoing_entry->priority);
+	send(outgoing_hdr, outgoing_buf, true);
+	outgoing_retries = 0;
+	outgoing_busy = 0;
+	outgoing_backoff = false;
+	if (outgoing_hdr->dst_count == 0) {
+		// Broadcasts are not acknowledged, so they are done once sent
+		outgoing_done(true);
+		return;
+	}
+	timeout_start(RETRIES_TIMEOUT_MS);
 }
 
 static void lpmacTask(UArg arg0, UArg arg1) {
@@ -329,24 +1078,34 @@ static void lpmacTask(UArg arg0, UArg arg1) {
 	dprintf("Radio Init\n");
 	radios->Init(&RadioEvents);
 
+#ifdef MULTICHANNEL_ENABLED
+	listen_channel = lpmac_channels_home(myid);
+	dprintf("Set home channel to %u\n", listen_channel);
+	radios->SetChannel(lpmac_channels_freq(listen_channel));
+#else
 	dprintf("Set channel to %u\n", RF_FREQUENCY);
 	radios->SetChannel(RF_FREQUENCY);
+#endif
 
 #if defined( USE_MODEM_LORA )
 
 	dprintf("Set TX and RX config\n");
-	Radio.SetTxConfig(MODEM_LORA, TX_OUTPUT_POWER, 0, LORA_BANDWIDTH,
-	LORA_SPREADING_FACTOR,
-	LORA_CODINGRATE,
-	LORA_PREAMBLE_LENGTH,
-	LORA_FIX_LENGTH_PAYLOAD_ON,
-	true, 0, 0, LORA_IQ_INVERSION_ON, 3000);
+	tx_config(LORA_PREAMBLE_LENGTH);
 
+#	ifdef LPL_ENABLED
+	// Accept the long wake up preambles and receive one packet per wake up
+	Radio.SetRxConfig(MODEM_LORA, LORA_BANDWIDTH, LORA_SPREADING_FACTOR,
+	LORA_CODINGRATE, 0, lpmac_lpl_preamble_long(),
+	LORA_SYMBOL_TIMEOUT,
+	LORA_FIX_LENGTH_PAYLOAD_ON, 0, true, 0, 0,
+	LORA_IQ_INVERSION_ON, false);
+#	else
 	Radio.SetRxConfig(MODEM_LORA, LORA_BANDWIDTH, LORA_SPREADING_FACTOR,
 	LORA_CODINGRATE, 0, LORA_PREAMBLE_LENGTH,
 	LORA_SYMBOL_TIMEOUT,
 	LORA_FIX_LENGTH_PAYLOAD_ON, 0, true, 0, 0,
 	LORA_IQ_INVERSION_ON, true);
+#	endif
 	dprintf("# Radio set TX and RX config\n");
 
 //    radios->Write(REG_LR_SYNCWORD, LPMAC_SYNCWORD);
@@ -374,9 +1133,28 @@ static void lpmacTask(UArg arg0, UArg arg1) {
 #error "Please define a frequency band in the compiler options."
 #endif
 
+#ifdef RTSCTS_ENABLED
+    // No exchange takes longer than one of the largest frame
+    nav_max_ms = rts_exchange_ms(UINT8_MAX);
+#endif
+
+#ifdef LPL_ENABLED
+    dprintf("LPL - Wake up every %u ms\n", LPL_WAKE_INTERVAL_MS);
+    listen();
+    lpmac_timer_start(&wakeTimer, LPL_WAKE_INTERVAL_MS, LPL_WAKE_INTERVAL_MS);
+#else
     dprintf("Radio.Rx( %u ) - Starting\n", RX_TIMEOUT_VALUE);
-    radios->Rx(RX_TIMEOUT_VALUE);
+    radio_rx(RX_TIMEOUT_VALUE);
     dprintf("Radio.Rx( %u ) - Finished\n", RX_TIMEOUT_VALUE);
+#endif
+
+#ifdef MULTICHANNEL_ENABLED
+    lpmac_timer_start(&hopTimer, CHANNEL_RDV_DWELL_MS, CHANNEL_RDV_DWELL_MS);
+#endif
+
+#ifdef MESH_ENABLED
+    advert_start();
+#endif
 
 	// Clear posted events from initialization
 //    clearevents(EVENT_TXDONE|EVENT_TXTIMEOUT|EVENT_RXDONE|EVENT_RXTIMEOUT|EVENT_CADDONE_DETECT|EVENT_CADDONE_NODETECT);
@@ -387,104 +1165,405 @@ static void lpmacTask(UArg arg0, UArg arg1) {
 
 		events = Event_pend(lpmacEventsHandle, Event_Id_NONE,
 				EVENT_JOIN | EVENT_SEND | EVENT_RECV | EVENT_RXDONE
-						| EVENT_RXTIMEOUT | EVENT_TIMEOUT,
+						| EVENT_RXTIMEOUT | EVENT_RXERROR | EVENT_TIMEOUT
+						| EVENT_HOP | EVENT_WAKE | EVENT_BEACON | EVENT_NEIGHBORS
+						| EVENT_ADVERT,
 				BIOS_WAIT_FOREVER);
 //        dprintf("events = 0x%X\n", events);
-		if (events & EVENT_JOIN) {
-			// JOIN
-			dprintf("Send JOIN\n");
-			char hdr_buf[PKT_HDR_CALC_SIZE(0)];
-			hdr = (pkt_hdr_t *) &hdr_buf;
-
-			hdr->src = getmyid();
+#		ifdef TDMA_ENABLED
+		if ((events & EVENT_BEACON) && lpmac_tdma_is_coordinator()) {
+			uint8_t beacon_hdr_buf[PKT_HDR_CALC_SIZE(0)];
+			uint8_t beacon_buf[TDMA_BEACON_CALC_SIZE(TDMA_SLOTS_MAX)];
+			struct tdma_beacon *beacon = (struct tdma_beacon *) beacon_buf;
+			hdr = (pkt_hdr_t *) &beacon_hdr_buf;
+
+			hdr->src = myid;
 			hdr->dst_count = 0; // Broadcast
-//            hdr->dst[0] = dst;
-			// REQ_ACK - Will send full ACKable packet back to assert presence
-			// NO_ACK  - Will simply send non-acked presence packet back
-			hdr->pkt_opts = PKT_OPTIONS_REQ_ACK;
-			hdr->pkt_type = PKT_TYPE_JOIN;
-			hdr->data_size = 0;
+			hdr->pkt_opts = PKT_OPTIONS_NO_ACK;
+			hdr->pkt_type = PKT_TYPE_BEACON;
 			hdr->pkt_id = next_pkt_id++;
+			hdr->data_size = lpmac_tdma_beacon(beacon_buf, sizeof(beacon_buf));
+			beacon_start(TDMA_SUPERFRAME_MS(beacon->slot_count));
 
-			send(hdr, NULL);
-			// Allow to go into Rx Mode again
-//            radios->Rx(RX_TIMEOUT_VALUE);
-
-			Event_post(lpmacRequestEventsHandle, EVENT_JOINDONE);
-
-		}
-		if (events & EVENT_SEND) {
-			// SEND
-			dprintf("Send Started\n");
-			send(outgoing_hdr, outgoing_buf);
-			// Allow to go into Rx Mode again
-//            radios->Rx(RX_TIMEOUT_VALUE);
-			// HACK/TEST
-			outgoing_retries = 0;
-			timeout_start(RETRIES_TIMEOUT_MS);
-
+			dprintf("Send BEACON %u with %u slots\n", beacon->seq, beacon->slot_count);
+			send(hdr, (char *) beacon_buf, false);
 		}
+#		endif
 		if (events & EVENT_RXDONE) {
 			// RX
+			bool ack = true;
+			bool busy = false;
+			bool deliver = true;
+			node_id_t origin;
+			rxq_buf_t *rx_buf = NULL;
+
 			dprintf("RX Packet\n");
 			hdr = (pkt_hdr_t *) Buffer;
+			origin = hdr->src;
+
+#			ifdef MESH_ENABLED
+			if ((hdr->pkt_type == PKT_TYPE_DATA)
+					&& (hdr->pkt_opts & PKT_OPTIONS_MESH)) {
+				pkt_mesh_ext_t *ext = PKT_MESH_EXT_PTR(hdr);
+				origin = ext->origin;
+				if (lpmac_routes_seen(ext->origin, ext->seq)) {
+					// Our last ACK was lost, ACK again but do not pass it on
+					dprintf("Duplicate mesh pkt %d from "PRINTF_FMT_NODE_ID"\n",
+							ext->seq, ext->origin);
+					lpmac_stats_add(LPMAC_STAT_DROP_DUPLICATE, 1);
+					lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_DUPLICATE, 0);
+					deliver = false;
+				} else if (ext->final_dst != myid) {
+					// Not remembered unless queued, so a resend after a busy
+					// answer is forwarded rather than taken for a duplicate
+					forward_result_t result = mesh_forward(hdr);
+					ack = (result == FORWARD_QUEUED);
+					busy = (result == FORWARD_BUSY);
+					deliver = false;
+				}
+			}
+#			endif
+
+			if (deliver && (hdr->pkt_type == PKT_TYPE_DATA)) {
+				size_t len = hdr->data_size;
+#				ifdef COMPRESS_ENABLED
+				if (hdr->pkt_opts & PKT_OPTIONS_COMPRESSED) {
+					len = lpmac_compress_size(PKT_DATA_PTR(hdr), hdr->data_size);
+				}
+#				endif
+				rx_buf = lpmac_rxq_reserve(len);
+				if (rx_buf == NULL) {
+					// The application fell behind. Answer busy, so the sender
+					// backs off without taking us for a failed link.
+					dprintf("RX queue full, packet %d answered busy\n", hdr->pkt_id);
+					lpmac_stats_add(LPMAC_STAT_DROP_RX_FULL, 1);
+					lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_RX_FULL, 0);
+					ack = false;
+					busy = true;
+					deliver = false;
+				}
+				else if (hdr->pkt_opts & PKT_OPTIONS_COMPRESSED) {
+					// Decompressed before deciding to ACK, so the sender
+					// retries if it used a dictionary we do not have
+#					ifdef COMPRESS_ENABLED
+					rx_buf->len = lpmac_decompress(hdr->src, PKT_DATA_PTR(hdr),
+							hdr->data_size, rx_buf->data, rx_buf->size);
+#					else
+					rx_buf->len = 0;
+#					endif
+					if (rx_buf->len == 0) {
+						dprintf("Cannot decompress packet %d\n", hdr->pkt_id);
+						lpmac_stats_add(LPMAC_STAT_DROP_DECOMPRESS, 1);
+						lpmac_trace(TRACE_RX_DROP, LPMAC_STAT_DROP_DECOMPRESS, 0);
+						lpmac_rxq_cancel(rx_buf);
+						rx_buf = NULL;
+						ack = false;
+						deliver = false;
+					}
+				}
+			}
+
+#			ifdef MESH_ENABLED
+			if (ack && (hdr->pkt_type == PKT_TYPE_DATA)
+					&& (hdr->pkt_opts & PKT_OPTIONS_MESH)) {
+				pkt_mesh_ext_t *ext = PKT_MESH_EXT_PTR(hdr);
+				if (!lpmac_routes_seen(ext->origin, ext->seq)) {
+					lpmac_routes_remember(ext->origin, ext->seq);
+				}
+			}
+#			endif
 
-			if (hdr->pkt_opts & PKT_OPTIONS_REQ_ACK) {
+			if ((ack || busy) && (hdr->pkt_opts & PKT_OPTIONS_REQ_ACK)) {
 				dprintf("Acknowledging packet %d\n", hdr->pkt_id);
 				outgoing_ack_hdr->pkt_type = PKT_TYPE_ACK;
-				outgoing_ack_hdr->pkt_opts = PKT_OPTIONS_NO_ACK;
+				outgoing_ack_hdr->pkt_opts = busy ? PKT_OPTIONS_BUSY : PKT_OPTIONS_NO_ACK;
 				outgoing_ack_hdr->pkt_id = hdr->pkt_id;
 				outgoing_ack_hdr->dst_count = 1;
 				outgoing_ack_hdr->src = myid;
 				outgoing_ack_hdr->dst[0] = hdr->src;
 				outgoing_ack_hdr->data_size = 0;
-
-				send(outgoing_ack_hdr, NULL);
+#				ifdef LPL_ENABLED
+				// Carries our wake phase, stamped by transmit()
+				outgoing_ack_hdr->data_size = ACK_DATA_SIZE;
+#				endif
+
+				// Only answers to broadcasts need to be spread out
+				send(outgoing_ack_hdr, NULL, hdr->dst_count == 0);
+				lpmac_stats_add(LPMAC_STAT_ACKS_SENT, 1);
 			}
 
 			switch (hdr->pkt_type) {
 			case PKT_TYPE_JOIN:
 				dprintf("Got JOIN with pkt_id=%d\n", hdr->pkt_id);
 				lpmac_neighbors_add(hdr->src, RssiValue);
+#				ifdef TDMA_ENABLED
+				lpmac_tdma_assign(hdr->src);
+#				endif
+#				ifdef MESH_ENABLED
+				lpmac_routes_update(hdr->src, lpmac_neighbors_etx(hdr->src),
+						PKT_DATA_PTR(hdr), hdr->data_size);
+#				endif
 				break;
 			case PKT_TYPE_UNJOIN:
 				dprintf("Got UNJOIN with pkt_id=%d\n", hdr->pkt_id);
 				lpmac_neighbors_rem(hdr->src);
+				lpmac_routes_neighbor_lost(hdr->src);
 				break;
 			case PKT_TYPE_ACK:
 				dprintf("Got ACK for pkt_id=%d\n", hdr->pkt_id);
-				if (outgoing_hdr && (outgoing_hdr->pkt_id == hdr->pkt_id)) {
-					outgoing_hdr = NULL;
+#				ifdef LPL_ENABLED
+				if (hdr->data_size >= sizeof(lpl_stamp_t)) {
+					lpl_stamp_t stamp;
+					memcpy(&stamp, PKT_DATA_PTR(hdr), sizeof(stamp));
+					lpmac_lpl_learn(hdr->src, stamp,
+							radios->TimeOnAir(MODEM_LORA, PKT_SIZE(hdr)));
+				}
+#				endif
+				if (outgoing_hdr && (outgoing_hdr->dst_count > 0)
+						&& (outgoing_hdr->pkt_id == hdr->pkt_id)
+						&& (hdr->pkt_opts & PKT_OPTIONS_BUSY)) {
+					// The receiver is there but out of buffers. Send again
+					// later, leaving its link quality and routes alone.
+					lpmac_stats_add(LPMAC_STAT_ACKS_BUSY, 1);
+					timeout_stop();
+					events &= ~EVENT_TIMEOUT;
+					clearevents(EVENT_TIMEOUT);
+					if (outgoing_busy++ < BUSY_RETRIES_MAX) {
+						lpmac_trace(TRACE_BACKOFF, BUSY_BACKOFF_MS, 0);
+						outgoing_backoff = true;
+						timeout_start(BUSY_BACKOFF_MS);
+					} else {
+						outgoing_done(false);
+					}
+				} else if (outgoing_hdr && (outgoing_hdr->dst_count > 0)
+						&& (outgoing_hdr->pkt_id == hdr->pkt_id)) {
+					lpmac_neighbors_acked(outgoing_hdr->dst[0], outgoing_retries + 1);
+					lpmac_stats_add(LPMAC_STAT_ACKS_RECEIVED, 1);
+					lpmac_trace(TRACE_ACK, hdr->pkt_id, outgoing_retries + 1);
 					timeout_stop();
 					events &= ~EVENT_TIMEOUT;
 					clearevents(EVENT_TIMEOUT);
-					Event_post(lpmacRequestEventsHandle, EVENT_SENDDONE_OK);
+					outgoing_done(true);
 				}
 				break;
 			case PKT_TYPE_DATA:
 				// Let user know about data recv
 				dprintf("Got DATA with pkt_id=%d\n", hdr->pkt_id);
-				rx_fn(PKT_DATA_PTR(hdr), hdr->data_size, hdr->src, RssiValue);
+#				ifdef TDMA_ENABLED
+				lpmac_tdma_assign(hdr->src);
+#				endif
+				if (deliver) {
+					// Handed to the delivery task, so the MAC never waits on the application
+					if (!(hdr->pkt_opts & PKT_OPTIONS_COMPRESSED)) {
+						memcpy(rx_buf->data, PKT_DATA_PTR(hdr), hdr->data_size);
+						rx_buf->len = hdr->data_size;
+					}
+#					ifdef COMPRESS_ENABLED
+					if (!(hdr->pkt_opts & PKT_OPTIONS_MESH)) {
+						lpmac_compress_received(hdr->src, rx_buf->data, rx_buf->len);
+					}
+#					endif
+					rx_buf->src = origin;
+					rx_buf->link_quality = RssiValue;
+					lpmac_rxq_deliver(rx_buf);
+				}
+				break;
+			case PKT_TYPE_RTS:
+				dprintf("Got RTS with pkt_id=%d\n", hdr->pkt_id);
+#				ifdef RTSCTS_ENABLED
+				// Stay quiet if we heard someone else's reservation
+				if (nav_remaining() == 0 && hdr->data_size >= sizeof(rts_duration_t)) {
+					uint8_t cts_buf[PKT_HDR_CALC_SIZE(1)];
+					pkt_hdr_t *cts = (pkt_hdr_t *) cts_buf;
+					uint32_t airtime = radios->TimeOnAir(RADIO_MODEM, PKT_SIZE(hdr));
+					rts_duration_t duration;
+					memcpy(&duration, PKT_DATA_PTR(hdr), sizeof(duration));
+					if (duration <= airtime) {
+						// Nothing left of the reservation, or a bogus RTS
+						break;
+					}
+					duration -= (rts_duration_t) airtime;
+
+					cts->pkt_type = PKT_TYPE_CTS;
+					cts->pkt_opts = PKT_OPTIONS_NO_ACK;
+					cts->pkt_id = hdr->pkt_id;
+					cts->dst_count = 1;
+					cts->data_size = sizeof(duration);
+					cts->src = myid;
+					cts->dst[0] = hdr->src;
+					send(cts, (char *) &duration, false);
+				}
+#				endif
+				break;
+			case PKT_TYPE_CTS:
+				// Handled in OnRxDone
+				break;
+			case PKT_TYPE_BCAST:
+#				ifdef BCAST_ENABLED
+				lpmac_bcast_symbol_rx(hdr->src, PKT_DATA_PTR(hdr), hdr->data_size);
+#				endif
+				break;
+			case PKT_TYPE_BCAST_POLL:
+#				ifdef BCAST_ENABLED
+				{
+					uint8_t nack_buf[PKT_HDR_CALC_SIZE(1)];
+					pkt_hdr_t *nack = (pkt_hdr_t *) nack_buf;
+					struct bcast_nack payload;
+					if (lpmac_bcast_poll_rx(hdr->src, PKT_DATA_PTR(hdr), hdr->data_size,
+							&payload)) {
+						nack->pkt_type = PKT_TYPE_BCAST_NACK;
+						nack->pkt_opts = PKT_OPTIONS_NO_ACK;
+						nack->pkt_id = hdr->pkt_id;
+						nack->dst_count = 1;
+						nack->data_size = sizeof(payload);
+						nack->src = myid;
+						nack->dst[0] = hdr->src;
+						// Every listener short of it answers the same poll
+						send(nack, (char *) &payload, true);
+					}
+				}
+#				endif
+				break;
+			case PKT_TYPE_BCAST_NACK:
+#				ifdef BCAST_ENABLED
+				lpmac_bcast_nack_rx(hdr->src, PKT_DATA_PTR(hdr), hdr->data_size);
+#				endif
+				break;
+			case PKT_TYPE_BEACON:
+				dprintf("Got BEACON from "PRINTF_FMT_NODE_ID"\n", hdr->src);
+#				ifdef TDMA_ENABLED
+				lpmac_tdma_beacon_rx(PKT_DATA_PTR(hdr), hdr->data_size, RxTicks,
+						radios->TimeOnAir(RADIO_MODEM, PKT_SIZE(hdr)));
+#				endif
 				break;
 			default:
 				dprintf("Bad packet type\n");
-				continue;
+				break;
 			}
+#			ifdef LPL_ENABLED
+			// Single receive mode left the radio in standby
+			listen();
+#			endif
 			// Allow to go into Rx Mode again
 //            radios->Rx(0);
 		}
 		if (events & EVENT_TIMEOUT) {
-			if (outgoing_retries++ < RETRIES_MAX) {
+			lpmac_trace(TRACE_TIMEOUT, outgoing_hdr->pkt_id, outgoing_retries);
+			if (outgoing_backoff) {
+				// Done waiting on a busy receiver, this attempt is free
+				outgoing_backoff = false;
+				send(outgoing_hdr, outgoing_buf, true);
+				timeout_start(RETRIES_TIMEOUT_MS);
+			} else if (outgoing_retries++ < RETRIES_MAX) {
 				// Try to resend
-				send(outgoing_hdr, outgoing_buf);
+				lpmac_stats_add(LPMAC_STAT_RETRIES, 1);
+				lpmac_stats_neighbor_add(outgoing_hdr->dst[0], STATS_NEIGHBOR_RETRIES, 1);
+#				ifdef COMPRESS_ENABLED
+				if (outgoing_retries == 1) {
+					// The receiver may not have the frame our dictionary names
+					outgoing_drop_dict();
+				}
+#				endif
+				send(outgoing_hdr, outgoing_buf, true);
 				timeout_start(RETRIES_TIMEOUT_MS);
 			} else {
 				// Failed to send
 			    lpmac_neighbors_failed(outgoing_hdr->dst[0]);
-				outgoing_hdr = NULL;
-				Event_post(lpmacRequestEventsHandle, EVENT_SENDDONE_FAIL);
+			    lpmac_routes_neighbor_lost(outgoing_hdr->dst[0]);
+			    lpmac_lpl_forget(outgoing_hdr->dst[0]);
+				outgoing_done(false);
+			}
+		}
+
+		// JOIN after ACKs and retransmissions, which keep transactions moving,
+		// and once any broadcast before it is done repeating
+		if (events & EVENT_JOIN) {
+			join_pending = true;
+		}
+		if (events & EVENT_ADVERT) {
+			advert_pending = true;
+		}
+		if ((join_pending || advert_pending) && !rdv_busy()) {
+			// JOIN, or a periodic JOIN without ACKs that only refreshes our routes
+			dprintf("Send JOIN\n");
+			char hdr_buf[PKT_HDR_CALC_SIZE(0)];
+			hdr = (pkt_hdr_t *) &hdr_buf;
+
+			hdr->src = getmyid();
+			hdr->dst_count = 0; // Broadcast
+//            hdr->dst[0] = dst;
+			// REQ_ACK - Will send full ACKable packet back to assert presence
+			// NO_ACK  - Will simply send non-acked presence packet back
+			hdr->pkt_opts = join_pending ? PKT_OPTIONS_REQ_ACK : PKT_OPTIONS_NO_ACK;
+			hdr->pkt_type = PKT_TYPE_JOIN;
+			hdr->data_size = 0;
+			hdr->pkt_id = next_pkt_id++;
+
+#			ifdef MESH_ENABLED
+			// Piggyback our routes on the JOIN
+			uint8_t adv_buf[PKT_PAYLOAD_MAX_SIZE(0)];
+			hdr->data_size = lpmac_routes_advertisement(adv_buf, sizeof(adv_buf));
+			send(hdr, (char *) adv_buf, true);
+#			else
+			send(hdr, NULL, true);
+#			endif
+			// Allow to go into Rx Mode again
+//            radios->Rx(RX_TIMEOUT_VALUE);
+
+#			ifdef MESH_ENABLED
+			// Any JOIN carried our routes, so the next refresh is a period away
+			advert_start();
+#			endif
+			if (join_pending) {
+				Event_post(lpmacRequestEventsHandle, EVENT_JOINDONE);
+			}
+			join_pending = false;
+			advert_pending = false;
+
+		}
+#		ifdef LPL_ENABLED
+		if (events & EVENT_WAKE) {
+			lpmac_lpl_woke();
+			// Only sample while idle, not while receiving or waiting for an ACK
+			if ((outgoing_hdr == NULL) && (radios->GetStatus() == RF_IDLE)) {
+				UInt cad;
+				radio_standby();
+				radio_cad();
+				cad = Event_pend(lpmacEventsHandle, Event_Id_NONE,
+						EVENT_CADDONE_DETECT | EVENT_CADDONE_NODETECT,
+						BIOS_WAIT_FOREVER);
+				if (cad & EVENT_CADDONE_DETECT) {
+					// Stay up for the rest of the preamble and the packet
+					dprintf("LPL - Activity Detected\n");
+					radio_rx(LPL_WAKE_INTERVAL_MS
+							+ radios->TimeOnAir(MODEM_LORA, BUFFER_SIZE - 1));
+				}
 			}
 		}
+		if (events & (EVENT_RXTIMEOUT | EVENT_RXERROR)) {
+			listen();
+		}
+#		endif
+
+#		ifdef MULTICHANNEL_ENABLED
+		if (events & EVENT_HOP) {
+			uint8_t channel = lpmac_channels_hop(myid,
+					(outgoing_hdr != NULL) || (rdv_copies > 0));
+			if (rdv_copies > 0) {
+				listen_channel = channel;
+				rdv_repeat();
+			} else if (channel != listen_channel) {
+				listen_channel = channel;
+				listen();
+			}
+		}
+#		endif
+
+		// Neighbor events, and lazy expiry of restored neighbors
+		lpmac_neighbors_docallbacks();
+
+		// SEND - Queued packets start here, once the MAC is free
+		outgoing_next();
 //        radios->Rx(RX_TIMEOUT_VALUE);
 
 		// Allow to go into Rx Mode again
@@ -505,9 +1584,32 @@ void LPMAC_Init(const struct Radio_s *radio,
 		neighbor_event_fn_t neighbor_updates_callback, rx_fn_t rx_callback) {
 
 	radios = radio;
-	rx_fn = rx_callback;
-	lpmac_neighbors_init(neighbor_updates_callback);
+	lpmac_rxq_init(rx_callback);
+	lpmac_neighbors_init(neighbor_updates_callback, neighbors_pending);
+	lpmac_routes_init();
+	lpmac_txq_init();
+	lpmac_stats_init();
+	lpmac_trace_init();
+	lpmac_energy_init(TX_OUTPUT_POWER);
+	lpmac_compress_init();
+#	ifdef BCAST_ENABLED
+	lpmac_bcast_init();
+#	endif
+	lpmac_timers_init();
 	timeout_init();
+#	ifdef MULTICHANNEL_ENABLED
+	hop_init();
+#	endif
+#	ifdef LPL_ENABLED
+	wake_init();
+#	endif
+#	ifdef MESH_ENABLED
+	advert_init();
+#	endif
+#	ifdef TDMA_ENABLED
+	beacon_init();
+	lpmac_tdma_init();
+#	endif
 
 	Event_construct(&lpmacEventsStruct, NULL);
 	lpmacEventsHandle = Event_handle(&lpmacEventsStruct);
@@ -526,31 +1628,83 @@ void LPMAC_Init(const struct Radio_s *radio,
 			NULL);
 }
 
+/**
+ * Queue a packet and wait for its transaction to finish.
+ * The caller keeps hdr and buf alive until then.
+ *
+ * @return true if it was acknowledged, or sent for broadcasts
+ */
+static bool submit(pkt_hdr_t *hdr, const uint8_t *buf, lpmac_priority_t priority) {
+	txq_entry_t entry;
+
+	// Setup send parameters
+	entry.hdr = hdr;
+	entry.buf = (uint8_t *) buf;
+	entry.priority = priority;
+	entry.forward = false;
+	entry.ok = false;
+	entry.queued = Clock_getTicks();
+	Semaphore_construct(&entry.done, 0, NULL);
+
+	// Set request to send
+	if (!lpmac_txq_push(&entry)) {
+		dprintf("Transmit queue full\n");
+		lpmac_stats_add(LPMAC_STAT_DROP_QUEUE_FULL, 1);
+		Semaphore_destruct(&entry.done);
+		return false;
+	}
+	Event_post(lpmacEventsHandle, EVENT_SEND);
+
+	// Wait for system to respond about send process
+	Semaphore_pend(Semaphore_handle(&entry.done), BIOS_WAIT_FOREVER);
+	Semaphore_destruct(&entry.done);
+
+	return entry.ok;
+}
+
 bool LPMAC_Send(const uint8_t *buf, size_t len, node_id_t dst) {
-	char hdr_buf[PKT_HDR_CALC_SIZE(1)];
+	return LPMAC_SendPriority(buf, len, dst, LPMAC_PRIORITY_NORMAL);
+}
+
+bool LPMAC_SendPriority(const uint8_t *buf, size_t len, node_id_t dst,
+		lpmac_priority_t priority) {
+	char hdr_buf[PKT_MESH_HDR_CALC_SIZE(1)];
 	struct pkt_hdr *hdr = (struct pkt_hdr *) &hdr_buf;
-	UInt events;
+
+	if (priority >= LPMAC_PRIORITY_COUNT) {
+		return false;
+	}
 
 	hdr->src = myid;
 	hdr->dst_count = 1;
 	hdr->dst[0] = dst;
-	hdr->pkt_opts = PKT_OPTIONS_REQ_ACK;
+	hdr->pkt_opts = PKT_OPTIONS_REQ_ACK
+			| ((priority << PKT_OPTIONS_PRIO_SHIFT) & PKT_OPTIONS_PRIO_MASK);
 	hdr->pkt_type = PKT_TYPE_DATA;
 	hdr->data_size = len;
-	hdr->pkt_id = next_pkt_id++;
+	hdr->pkt_id = 0; // Assigned when sent
 
-	// Setup send parameters
-	outgoing_buf = buf;
-	outgoing_hdr = hdr;
-
-	// Set request to send
-	Event_post(lpmacEventsHandle, EVENT_SEND);
+#	ifdef MESH_ENABLED
+	{
+		// Without a route, fall back to trying dst directly
+		node_id_t next_hop = lpmac_routes_lookup(dst);
+		if (next_hop != 0 && next_hop != dst) {
+			pkt_mesh_ext_t *ext = PKT_MESH_EXT_PTR(hdr);
+			hdr->pkt_opts |= PKT_OPTIONS_MESH;
+			hdr->dst[0] = next_hop;
+			ext->origin = myid;
+			ext->final_dst = dst;
+			ext->seq = 0; // Set to the pkt_id when sent
+			ext->hops_left = MESH_HOPS_MAX - 1;
+		}
+	}
+#	endif
 
-	// Wait for system to respond about send process
-	events = Event_pend(lpmacRequestEventsHandle, Event_Id_NONE,
-			EVENT_SENDDONE_OK | EVENT_SENDDONE_FAIL, BIOS_WAIT_FOREVER);
+	return submit(hdr, buf, priority);
+}
 
-	return (events & EVENT_SENDDONE_OK) ? 1 : 0;
+bool LPMAC_RxBufferPost(uint8_t *buf, size_t size) {
+	return lpmac_rxq_post(buf, size);
 }
 
 bool LPMAC_Join() {
@@ -584,6 +1738,184 @@ void LPMAC_Neighbors() {
     lpmac_neighbors_show();
 }
 
+size_t LPMAC_NeighborsSnapshot(lpmac_neighbor_t *neighbors, size_t max) {
+    return lpmac_neighbors_snapshot(neighbors, max);
+}
+
+void LPMAC_TdmaCoordinator(bool enable) {
+#ifdef TDMA_ENABLED
+	lpmac_tdma_coordinator(enable, myid);
+	if (enable) {
+		// Send the first beacon right away
+		Event_post(lpmacEventsHandle, EVENT_BEACON);
+	} else {
+		Clock_stop(Clock_handle(&beaconStruct));
+	}
+#endif
+}
+
+#ifdef BCAST_ENABLED
+/**
+ * Broadcast the reliable broadcast frame in bcast_buf
+ */
+static bool bcast_submit(enum pkt_type type, size_t size) {
+	uint8_t hdr_buf[PKT_HDR_CALC_SIZE(0)];
+	pkt_hdr_t *hdr = (pkt_hdr_t *) hdr_buf;
+
+	if (size == 0) {
+		return false;
+	}
+	hdr->pkt_type = type;
+	hdr->pkt_opts = PKT_OPTIONS_NO_ACK
+			| ((LPMAC_PRIORITY_BULK << PKT_OPTIONS_PRIO_SHIFT) & PKT_OPTIONS_PRIO_MASK);
+	hdr->pkt_id = 0; // Assigned when sent
+	hdr->dst_count = 0;
+	hdr->data_size = size;
+	hdr->src = myid;
+	return submit(hdr, bcast_buf, LPMAC_PRIORITY_BULK);
+}
+#endif
+
+bool LPMAC_Broadcast(const uint8_t *obj, size_t size) {
+#ifdef BCAST_ENABLED
+	uint16_t generations = lpmac_bcast_tx_begin(obj, size);
+	uint16_t generation;
+	bool ok = true;
+
+	if (generations == 0) {
+		return false;
+	}
+	for (generation = 0; generation < generations; generation++) {
+		uint8_t k = lpmac_bcast_k(generation);
+		uint16_t served = 0;
+		uint8_t fewest = UINT8_MAX; // Worst missing count seen for served
+		unsigned quiet = 0;
+		unsigned rounds = 0;
+		unsigned repairs;
+		uint8_t index;
+
+		dprintf("Broadcast generation %u of %u\n", generation + 1, generations);
+		for (index = 0; index < k; index++) {
+			bcast_submit(PKT_TYPE_BCAST,
+					lpmac_bcast_symbol(generation, index, bcast_buf, sizeof(bcast_buf)));
+		}
+		for (repairs = 0; repairs < BCAST_REPAIR_EXTRA; repairs++) {
+			bcast_submit(PKT_TYPE_BCAST,
+					lpmac_bcast_repair(generation, bcast_buf, sizeof(bcast_buf)));
+		}
+
+		// Listeners NACK the oldest generation they lack, so stragglers are served here too
+		while (quiet < BCAST_QUIET_POLLS) {
+			uint16_t target;
+			uint8_t missing;
+
+			bcast_submit(PKT_TYPE_BCAST_POLL,
+					lpmac_bcast_poll(generation, bcast_buf, sizeof(bcast_buf)));
+			Task_sleep(BCAST_POLL_WINDOW_MS * TIME_MS);
+			if (lpmac_bcast_nacks(&target, &missing) == 0) {
+				quiet++;
+				continue;
+			}
+			quiet = 0;
+
+			// Only count rounds that make no headway, toward a later
+			// generation or fewer missing symbols in the same one
+			if (target > served || (target == served && missing < fewest)) {
+				served = target;
+				fewest = missing;
+				rounds = 0;
+			}
+			if (++rounds > BCAST_ROUNDS_MAX) {
+				dprintf("Broadcast generation %u still NACKed, giving up\n", target + 1);
+				lpmac_bcast_give_up(target);
+				ok = false;
+				rounds = 0;
+				continue;
+			}
+
+			// One repair frame serves every listener, so only the worst counts
+			for (repairs = missing + BCAST_REPAIR_EXTRA; repairs > 0; repairs--) {
+				bcast_submit(PKT_TYPE_BCAST,
+						lpmac_bcast_repair(target, bcast_buf, sizeof(bcast_buf)));
+			}
+		}
+	}
+	lpmac_bcast_tx_end();
+	return ok;
+#else
+	return false;
+#endif
+}
+
+void LPMAC_BroadcastListen(bcast_fn_t callback) {
+#ifdef BCAST_ENABLED
+	lpmac_bcast_listen(callback);
+#endif
+}
+
+void LPMAC_Routes() {
+    lpmac_routes_show();
+}
+
 void LPMAC_Clear() {
     lpmac_neighbors_clear();
+    lpmac_routes_clear();
+}
+
+bool LPMAC_SaveNeighbors(const struct lpmac_storage *storage) {
+    return lpmac_neighbors_save(storage, getmyid());
+}
+
+bool LPMAC_RestoreNeighbors(const struct lpmac_storage *storage) {
+    return lpmac_neighbors_restore(storage, getmyid()) > 0;
+}
+
+void LPMAC_GetStats(lpmac_stats_t *stats) {
+#ifdef STATS_ENABLED
+    lpmac_stats_get(stats);
+#else
+    memset(stats, 0, sizeof(*stats));
+#endif
+}
+
+size_t LPMAC_GetNeighborStats(lpmac_neighbor_stats_t *stats, size_t max) {
+#ifdef STATS_ENABLED
+    return lpmac_stats_neighbors_get(stats, max);
+#else
+    return 0;
+#endif
+}
+
+void LPMAC_ResetStats() {
+    lpmac_stats_reset();
+}
+
+void LPMAC_Stats() {
+#ifdef STATS_ENABLED
+    lpmac_stats_show();
+#endif
+}
+
+void LPMAC_TraceDump() {
+#ifdef TRACE_ENABLED
+    lpmac_trace_dump();
+#endif
+}
+
+void LPMAC_GetEnergy(lpmac_energy_t *energy) {
+#ifdef ENERGY_ENABLED
+    lpmac_energy_get(energy);
+#else
+    memset(energy, 0, sizeof(*energy));
+#endif
+}
+
+void LPMAC_ResetEnergy() {
+    lpmac_energy_reset();
+}
+
+void LPMAC_Energy() {
+#ifdef ENERGY_ENABLED
+    lpmac_energy_show();
+#endif
 }
@@ -13,6 +13,8 @@ extern "C" {
 #endif
 
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
 #include <radio.h>
 
 #define PRINTF_FMT_NODE_ID "%8.8X"
@@ -23,19 +25,164 @@ typedef enum {
 	NEIGHBOR_EVENT_UPDATE,
 } neighbor_event_t;
 
+/**
+ * Transmit priority classes, served in strict priority order
+ */
+typedef enum {
+    LPMAC_PRIORITY_CONTROL = 0,
+    LPMAC_PRIORITY_URGENT,
+    LPMAC_PRIORITY_NORMAL,
+    LPMAC_PRIORITY_BULK,
+    LPMAC_PRIORITY_COUNT
+} lpmac_priority_t;
+
 typedef uint32_t node_id_t;
 typedef uint8_t  link_quality_t;
 
+/**
+ * MAC wide counters, see LPMAC_GetStats.
+ * The trace records drop reasons by these values, so only append.
+ */
+typedef enum {
+    LPMAC_STAT_TX_FRAMES = 0,   // Radio transmissions of any kind
+    LPMAC_STAT_TX_BYTES,
+    LPMAC_STAT_TX_TIMEOUTS,     // Transmissions the radio gave up on
+    LPMAC_STAT_TX_AIRTIME_MS,
+    LPMAC_STAT_RX_FRAMES,       // Received frames with a valid size
+    LPMAC_STAT_RX_BYTES,
+    LPMAC_STAT_ACKS_SENT,
+    LPMAC_STAT_ACKS_RECEIVED,   // ACKs that finished our transaction
+    LPMAC_STAT_RETRIES,
+    LPMAC_STAT_SEND_OK,         // Queued packets that were acknowledged
+    LPMAC_STAT_SEND_FAIL,       // Queued packets that ran out of retries
+    LPMAC_STAT_FORWARDED,       // Mesh packets accepted for forwarding
+    LPMAC_STAT_CAD_BUSY,        // Channel activity detections before sending
+    LPMAC_STAT_DROP_CRC,        // Radio receive errors
+    LPMAC_STAT_DROP_RUNT,       // Smaller than a header
+    LPMAC_STAT_DROP_SIZE,       // Size disagrees with the header
+    LPMAC_STAT_DROP_FILTER,     // Addressed to someone else
+    LPMAC_STAT_DROP_DUPLICATE,  // Mesh packet we already accepted
+    LPMAC_STAT_DROP_NO_ROUTE,   // Mesh packet we could not forward
+    LPMAC_STAT_DROP_QUEUE_FULL, // Send or forward refused by the transmit queue
+    LPMAC_STAT_DROP_RX_FULL,    // Answered busy, no receive buffer was free
+    LPMAC_STAT_DROP_DECOMPRESS, // Not acknowledged, the payload would not decompress
+    LPMAC_STAT_TX_COMPRESSED,   // DATA frames sent compressed
+    LPMAC_STAT_TX_BYTES_SAVED,  // Payload bytes compression kept off the air, once per frame
+    LPMAC_STAT_ACKS_BUSY,       // ACKs telling us the receiver had no buffer free
+    LPMAC_STAT_COUNT
+} lpmac_stat_t;
+
+/**
+ * Fixed bucket histograms, see LPMAC_GetStats.
+ * The time histograms use upper bounds of 50, 100, 200, 500, 1000,
+ * 2000 and 5000 ms, with the last bucket holding everything longer.
+ * The retries histogram counts acknowledged packets by attempts,
+ * bucket 0 being acknowledged on the first try.
+ */
+typedef enum {
+    LPMAC_HIST_SEND_LATENCY = 0, // Queued until acknowledged or failed
+    LPMAC_HIST_CAD_WAIT,         // Listen before talk until the channel was clear
+    LPMAC_HIST_RETRIES,
+    LPMAC_HIST_COUNT
+} lpmac_hist_t;
+
+#define LPMAC_HIST_BUCKETS 8
+
+typedef struct {
+    uint32_t uptime_ms;  // Time since the stats were last reset
+    uint32_t counters[LPMAC_STAT_COUNT];
+    uint32_t hist[LPMAC_HIST_COUNT][LPMAC_HIST_BUCKETS];
+} lpmac_stats_t;
+
+/**
+ * Radio states for energy accounting, see LPMAC_GetEnergy
+ */
+typedef enum {
+    LPMAC_RADIO_SLEEP = 0,
+    LPMAC_RADIO_STANDBY,
+    LPMAC_RADIO_RX,
+    LPMAC_RADIO_TX,
+    LPMAC_RADIO_CAD,
+    LPMAC_RADIO_STATE_COUNT
+} lpmac_radio_state_t;
+
+typedef struct {
+    uint32_t uptime_ms;  // Time since the accounting was last reset
+    uint32_t time_ms[LPMAC_RADIO_STATE_COUNT];
+    uint64_t energy_uj[LPMAC_RADIO_STATE_COUNT];
+    uint64_t total_uj;
+    uint32_t mj_per_day; // Total energy projected over a day at the same rate
+} lpmac_energy_t;
+
+/**
+ * Per neighbor counters, for the neighbors we exchanged the most with recently
+ */
+typedef struct {
+    node_id_t id;
+    uint32_t  tx_frames;   // Packets we started sending to it
+    uint32_t  tx_airtime_ms;
+    uint32_t  tx_energy_uj; // Radio energy of our packets and ACKs to it
+    uint32_t  acked;
+    uint32_t  retries;
+    uint32_t  failures;
+    uint32_t  rx_frames;
+    int16_t   rssi;        // Of the last frame received from it
+} lpmac_neighbor_stats_t;
+
+/**
+ * A neighbor table entry, see LPMAC_NeighborsSnapshot
+ */
+typedef struct {
+    node_id_t      id;
+    link_quality_t link_quality;
+    uint16_t       etx;      // Expected transmissions per delivery, times 8
+    uint32_t       heard_ms; // Time since it was last heard
+    bool           verified; // False for entries restored from storage and not heard since
+} lpmac_neighbor_t;
+
 typedef void (*neighbor_event_fn_t)(neighbor_event_t type, node_id_t id, link_quality_t link_quality);
 typedef void (*rx_fn_t)(uint8_t *buf, size_t buf_size, node_id_t dst, link_quality_t link_quality);
+typedef void (*bcast_fn_t)(node_id_t src, uint8_t object, uint32_t offset,
+        const uint8_t *data, size_t len, uint32_t size);
 
+/**
+ * Start the MAC. neighbor_updates_callback runs on the MAC task, shortly
+ * after the change it reports, and may look at the neighbor table.
+ * rx_callback runs on the MAC's delivery task, so it may
+ * take its time, but a slow callback holds up later deliveries and
+ * eventually makes the MAC stop acknowledging data.
+ * The buffer it gets is only valid until it returns, unless it was posted
+ * with LPMAC_RxBufferPost.
+ */
 void
 LPMAC_Init(const struct Radio_s *radio,
            neighbor_event_fn_t neighbor_updates_callback,
            rx_fn_t rx_callback);
+
+/**
+ * Give the MAC a buffer to receive data into. Once passed to the rx
+ * callback, the buffer belongs to the application, which may keep it
+ * as long as it likes and post it again when done. Posted buffers are
+ * used in addition to the MAC's own RXQ_BUFFERS.
+ *
+ * @return false if RXQ_APP_BUFFERS_MAX buffers are already posted
+ */
+bool
+LPMAC_RxBufferPost(uint8_t *buf, size_t size);
 bool
 LPMAC_Send(const uint8_t *buf, size_t len, node_id_t dst);
 
+/**
+ * Send with a priority class. Urgent packets go before any queued normal
+ * or bulk packets, but never interrupt a packet already being retried.
+ * LPMAC_Send is the same as LPMAC_PRIORITY_NORMAL.
+ *
+ * @return true if dst acknowledged the packet
+ */
+bool
+LPMAC_SendPriority(const uint8_t *buf, size_t len, node_id_t dst,
+                   lpmac_priority_t priority);
+
 /**
  * This will send a join packet and rebuild the
  * @return true is at least one neighbor was found, false if no neighbors were found
@@ -46,10 +193,111 @@ LPMAC_Join();
 node_id_t
 LPMAC_MyId(node_id_t id);
 
+/**
+ * Broadcast a JOIN now, asking neighbors to answer. With MESH_ENABLED our
+ * routes are also re-advertised on their own about every ROUTES_ADVERT_MS.
+ */
 void LPMAC_Announce();
+
+/**
+ * Make this node the TDMA coordinator, which sends beacons and assigns slots
+ * to every node it hears from. Nodes that hear its beacons transmit only in
+ * their slots. Only available with TDMA_ENABLED.
+ */
+void LPMAC_TdmaCoordinator(bool enable);
+
+/**
+ * Reliably broadcast an object to every listening neighbor at once.
+ * The object is sent a generation at a time with erasure coded repair
+ * frames, until polls draw no more NACKs. This blocks until it is done.
+ * Only available with BCAST_ENABLED.
+ *
+ * @return true if the final polls drew no NACKs, false if a generation was given up on
+ */
+bool LPMAC_Broadcast(const uint8_t *obj, size_t size);
+
+/**
+ * Take part in reliable broadcasts. callback runs on the delivery task with
+ * each part of an object as it is decoded, and must be done with data when
+ * it returns. A listener that misses a part for good sees a gap in offset.
+ * Only available with BCAST_ENABLED.
+ */
+void LPMAC_BroadcastListen(bcast_fn_t callback);
 void LPMAC_Neighbors();
+
+/**
+ * Copy the neighbor table. This never blocks the MAC.
+ *
+ * @param neighbors Array to fill
+ * @param max Number of entries neighbors can hold
+ * @return The number of neighbors copied
+ */
+size_t LPMAC_NeighborsSnapshot(lpmac_neighbor_t *neighbors, size_t max);
+void LPMAC_Routes();
 void LPMAC_Clear();
 
+struct lpmac_storage;
+
+/**
+ * Save the neighbor table, see lpmac_storage.h for the storage backends.
+ * Flash wears out, so save when the table changed rather than periodically.
+ *
+ * @return true if the snapshot was written
+ */
+bool LPMAC_SaveNeighbors(const struct lpmac_storage *storage);
+
+/**
+ * Restore a saved neighbor table after a reboot, instead of LPMAC_Join.
+ * Restored neighbors that are not heard from again are dropped.
+ *
+ * @return true if at least one neighbor was restored, otherwise call LPMAC_Join
+ */
+bool LPMAC_RestoreNeighbors(const struct lpmac_storage *storage);
+
+/**
+ * Copy the MAC counters and histograms. These are all zero
+ * without STATS_ENABLED.
+ */
+void LPMAC_GetStats(lpmac_stats_t *stats);
+
+/**
+ * Copy the per neighbor counters, of which there are none
+ * without STATS_ENABLED.
+ *
+ * @param stats Array to fill
+ * @param max Number of entries stats can hold
+ * @return The number of entries copied
+ */
+size_t LPMAC_GetNeighborStats(lpmac_neighbor_stats_t *stats, size_t max);
+
+/**
+ * Zero all counters and histograms
+ */
+void LPMAC_ResetStats();
+
+/**
+ * Print the MAC counters
+ */
+void LPMAC_Stats();
+
+/**
+ * Copy the radio time and energy spent in each state. These are all zero
+ * without ENERGY_ENABLED. Only the radio is counted, not the MCU.
+ */
+void LPMAC_GetEnergy(lpmac_energy_t *energy);
+void LPMAC_ResetEnergy();
+
+/**
+ * Print the radio energy use
+ */
+void LPMAC_Energy();
+
+/**
+ * Print and clear the event trace, for tools/lpmac_trace.py.
+ * Only available with TRACE_ENABLED.
+ */
+void LPMAC_TraceDump();
+
 #ifdef __cplusplus
 }
 #endif
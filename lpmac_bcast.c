@@ -0,0 +1,475 @@
+/**@file lpmac_bcast.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ti/sysbios/gates/GateMutexPri.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_bcast_errors.h"
+#include "lpmac_rxq.h"
+#include "lpmac_bcast.h"
+
+#define BCAST_GENERATION_SIZE ((uint32_t) BCAST_GENERATION * BCAST_SYMBOL_SIZE)
+#define COEFS_ALL(k) (((k) >= 32) ? 0xFFFFFFFFUL : ((1UL << (k)) - 1))
+
+static bcast_fn_t bcast_fn;
+
+static GateMutexPri_Struct bcastMutexStruct;
+
+/* The object we are sending */
+static struct {
+    bool           busy;
+    const uint8_t *obj;
+    uint32_t       size;
+    uint8_t        object;
+    uint16_t       generations;
+    uint16_t       first;   // Generations before this are given up on
+    uint16_t       polled;  // The generation last polled
+    uint8_t        nacks;   // Answers to that poll
+    uint16_t       target;  // The oldest generation they asked for
+    uint8_t        missing; // The most symbols any of them asked for of target
+} tx;
+static uint8_t next_object;
+
+/* The generation we are receiving */
+static struct {
+    bool       active;
+    bool       complete;
+    bool       delivering; // Handed to the delivery task, not ours until it returns
+    node_id_t  src;
+    uint8_t    object;
+    uint16_t   generation;
+    uint16_t   generations; // 0 until a poll tells us
+    uint8_t    k;           // 0 until we hear a symbol or poll of the generation
+    uint8_t    symbol_size;
+    uint32_t   offset;
+    uint32_t   size;
+    uint8_t    rank;
+    uint32_t   coefs[BCAST_GENERATION]; // Row p has p as its lowest bit
+} rx;
+static uint8_t rx_rows[BCAST_GENERATION_SIZE];
+static rxq_buf_t rx_deliver_buf;
+
+void lpmac_bcast_init() {
+    GateMutexPri_construct(&bcastMutexStruct, NULL);
+    bcast_fn = NULL;
+    tx.busy = false;
+    rx.active = false;
+    rx.delivering = false;
+}
+
+/**
+ * Start taking part in broadcasts, or stop with a NULL callback
+ */
+void lpmac_bcast_listen(bcast_fn_t callback) {
+    bcast_fn = callback;
+}
+
+/*
+ * Sending, from the task calling LPMAC_Broadcast, while the MAC task
+ * collects the NACKs
+ */
+
+/**
+ * Start sending an object.
+ *
+ * @return The number of generations, or 0 if another broadcast is under way
+ */
+uint16_t lpmac_bcast_tx_begin(const uint8_t *obj, size_t size) {
+    uint32_t generations = (size + BCAST_GENERATION_SIZE - 1) / BCAST_GENERATION_SIZE;
+    UInt key;
+
+    if (size == 0 || generations > UINT16_MAX) {
+        return 0;
+    }
+    key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    if (tx.busy) {
+        GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+        return 0;
+    }
+    tx.busy = true;
+    tx.obj = obj;
+    tx.size = size;
+    tx.object = next_object++;
+    tx.generations = (uint16_t) generations;
+    tx.first = 0;
+    tx.nacks = 0;
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+    return tx.generations;
+}
+
+/**
+ * @return The number of symbols in a generation, which is only short for the last
+ */
+uint8_t lpmac_bcast_k(uint16_t generation) {
+    uint32_t left = tx.size - ((uint32_t) generation * BCAST_GENERATION_SIZE);
+    if (left >= BCAST_GENERATION_SIZE) {
+        return BCAST_GENERATION;
+    }
+    return (uint8_t) ((left + BCAST_SYMBOL_SIZE - 1) / BCAST_SYMBOL_SIZE);
+}
+
+/**
+ * Build a symbol payload, the XOR of the generation's symbols in coefs
+ */
+static size_t bcast_combine(uint16_t generation, uint32_t coefs, uint8_t *buf, size_t buf_size) {
+    struct bcast_symbol hdr;
+    uint8_t *data = buf + sizeof(hdr);
+    uint32_t offset = (uint32_t) generation * BCAST_GENERATION_SIZE;
+    uint8_t index;
+
+    if (buf_size < (sizeof(hdr) + BCAST_SYMBOL_SIZE)) {
+        return 0;
+    }
+    hdr.object = tx.object;
+    hdr.k = lpmac_bcast_k(generation);
+    hdr.symbol_size = BCAST_SYMBOL_SIZE;
+    hdr.generation = generation;
+    hdr.first = tx.first;
+    hdr.offset = offset;
+    hdr.size = tx.size;
+    hdr.coefs = coefs;
+    memcpy(buf, &hdr, sizeof(hdr));
+
+    // The last symbol of the object reads as zeros past its end
+    memset(data, 0, BCAST_SYMBOL_SIZE);
+    for (index = 0; index < hdr.k; index++) {
+        uint32_t start = offset + ((uint32_t) index * BCAST_SYMBOL_SIZE);
+        uint32_t len = tx.size - start;
+        uint32_t byte;
+        if (!(coefs & (1UL << index))) {
+            continue;
+        }
+        if (len > BCAST_SYMBOL_SIZE) {
+            len = BCAST_SYMBOL_SIZE;
+        }
+        for (byte = 0; byte < len; byte++) {
+            data[byte] ^= tx.obj[start + byte];
+        }
+    }
+    return sizeof(hdr) + BCAST_SYMBOL_SIZE;
+}
+
+/**
+ * Build the payload carrying one of the generation's symbols as it is
+ */
+size_t lpmac_bcast_symbol(uint16_t generation, uint8_t index, uint8_t *buf, size_t buf_size) {
+    return bcast_combine(generation, 1UL << index, buf, buf_size);
+}
+
+/**
+ * Build the payload of a repair symbol, a random combination of the generation
+ */
+size_t lpmac_bcast_repair(uint16_t generation, uint8_t *buf, size_t buf_size) {
+    uint32_t all = COEFS_ALL(lpmac_bcast_k(generation));
+    uint32_t coefs;
+    size_t chunk;
+    do {
+        // RAND_MAX may be as small as 15 bits, so take the top 8 of those
+        // four times over, which also skips the weak low bits of an LCG
+        coefs = 0;
+        for (chunk = 0; chunk < sizeof(coefs); chunk++) {
+            coefs = (coefs << 8) | (((uint32_t) rand() >> 7) & 0xFF);
+        }
+        coefs &= all;
+    } while (coefs == 0);
+    return bcast_combine(generation, coefs, buf, buf_size);
+}
+
+/**
+ * Build a poll payload, and start collecting the NACKs that answer it
+ */
+size_t lpmac_bcast_poll(uint16_t generation, uint8_t *buf, size_t buf_size) {
+    struct bcast_poll poll;
+    UInt key;
+
+    if (buf_size < sizeof(poll)) {
+        return 0;
+    }
+    poll.object = tx.object;
+    poll.k = lpmac_bcast_k(generation);
+    poll.generation = generation;
+    poll.first = tx.first;
+    poll.generations = tx.generations;
+    memcpy(buf, &poll, sizeof(poll));
+
+    key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    tx.polled = generation;
+    tx.nacks = 0;
+    tx.missing = 0;
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+    return sizeof(poll);
+}
+
+/**
+ * @param generation Set to the oldest generation asked for
+ * @param missing Set to the most symbols any NACK asked for of it
+ * @return The number of NACKs to the last poll
+ */
+uint8_t lpmac_bcast_nacks(uint16_t *generation, uint8_t *missing) {
+    uint8_t nacks;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    nacks = tx.nacks;
+    *generation = tx.target;
+    *missing = tx.missing;
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+    if (nacks > 0 && *missing > lpmac_bcast_k(*generation)) {
+        *missing = lpmac_bcast_k(*generation);
+    }
+    return nacks;
+}
+
+/**
+ * Stop repairing a generation and those before it
+ */
+void lpmac_bcast_give_up(uint16_t generation) {
+    dprintf("Giving up on generation %u\n", generation);
+    tx.first = generation + 1;
+}
+
+void lpmac_bcast_tx_end() {
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    tx.busy = false;
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+}
+
+void lpmac_bcast_nack_rx(node_id_t src, const uint8_t *payload, size_t size) {
+    struct bcast_nack nack;
+    UInt key;
+
+    if (size < sizeof(nack)) {
+        return;
+    }
+    memcpy(&nack, payload, sizeof(nack));
+    key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    if (tx.busy && nack.object == tx.object && nack.generation >= tx.first
+            && nack.generation <= tx.polled) {
+        dprintf("NACK from "PRINTF_FMT_NODE_ID" for generation %u missing %u\n",
+                src, nack.generation, nack.missing);
+        if (tx.nacks == 0 || nack.generation < tx.target) {
+            tx.target = nack.generation;
+            tx.missing = nack.missing;
+        } else if (nack.generation == tx.target && nack.missing > tx.missing) {
+            tx.missing = nack.missing;
+        }
+        if (tx.nacks < UINT8_MAX) {
+            tx.nacks++;
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+}
+
+/*
+ * Receiving, on the MAC task. The lock is only held against the delivery task.
+ */
+
+static bool rx_delivering() {
+    bool delivering;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    delivering = rx.delivering;
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+    return delivering;
+}
+
+static void rx_start(node_id_t src, uint8_t object, uint16_t generation) {
+    if (rx.active && !rx.complete && (rx.src != src || rx.object != object
+            || rx.generation != generation)) {
+        dprintf("Lost generation %u of object %u\n", rx.generation, rx.object);
+    }
+    if (!rx.active || rx.src != src || rx.object != object) {
+        rx.generations = 0;
+    }
+    rx.active = true;
+    rx.complete = false;
+    rx.src = src;
+    rx.object = object;
+    rx.generation = generation;
+    rx.k = 0;
+    rx.rank = 0;
+    memset(rx.coefs, 0, sizeof(rx.coefs));
+}
+
+/**
+ * Move on to the generation we need next, if that is not the one we have.
+ * Must not be called while delivering.
+ *
+ * @return false if we have every generation we can still get
+ */
+static bool rx_next(node_id_t src, uint8_t object, uint16_t first) {
+    if (!rx.active || rx.src != src || rx.object != object) {
+        rx_start(src, object, first);
+    } else if (rx.complete) {
+        uint16_t next = rx.generation + 1;
+        if (rx.generations != 0 && next >= rx.generations) {
+            return false;
+        }
+        rx_start(src, object, (next > first) ? next : first);
+    } else if (rx.generation < first) {
+        // The sender gave up on it
+        rx_start(src, object, first);
+    }
+    return true;
+}
+
+/**
+ * Runs on the delivery task with a solved generation
+ */
+static void rx_deliver(rxq_buf_t *buf) {
+    bcast_fn(buf->src, rx.object, rx.offset, buf->data, buf->len, rx.size);
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    rx.delivering = false;
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+}
+
+static inline void rows_xor(uint8_t *dst, const uint8_t *src, size_t size) {
+    while (size--) {
+        *dst++ ^= *src++;
+    }
+}
+
+/**
+ * Back substitute so that row p holds symbol p itself
+ */
+static void rx_solve() {
+    size_t size = rx.symbol_size;
+    int row;
+    for (row = rx.k - 1; row >= 0; row--) {
+        uint8_t bit;
+        for (bit = row + 1; bit < rx.k; bit++) {
+            if (rx.coefs[row] & (1UL << bit)) {
+                rx.coefs[row] ^= rx.coefs[bit];
+                rows_xor(&rx_rows[row * size], &rx_rows[bit * size], size);
+            }
+        }
+    }
+}
+
+/**
+ * Take in a symbol. The payload is used as scratch space.
+ */
+void lpmac_bcast_symbol_rx(node_id_t src, uint8_t *payload, size_t size) {
+    struct bcast_symbol hdr;
+    uint8_t *data = payload + sizeof(hdr);
+    uint32_t coefs;
+    uint8_t bit;
+    UInt key;
+
+    if (bcast_fn == NULL || size < sizeof(hdr)) {
+        return;
+    }
+    memcpy(&hdr, payload, sizeof(hdr));
+    if (hdr.k == 0 || hdr.k > BCAST_GENERATION || hdr.symbol_size == 0
+            || hdr.symbol_size > BCAST_SYMBOL_SIZE
+            || size != (sizeof(hdr) + hdr.symbol_size)
+            || hdr.coefs == 0 || (hdr.coefs & ~COEFS_ALL(hdr.k))
+            || hdr.offset >= hdr.size) {
+        return;
+    }
+
+    // A poll will tell the sender what we miss while delivering
+    if (rx_delivering() || !rx_next(src, hdr.object, hdr.first)) {
+        return;
+    }
+    if (hdr.generation != rx.generation || rx.complete) {
+        return;
+    }
+    rx.k = hdr.k;
+    rx.symbol_size = hdr.symbol_size;
+    rx.offset = hdr.offset;
+    rx.size = hdr.size;
+
+    // Reduce by the rows we have, lowest bit first, leaving only new bits
+    coefs = hdr.coefs;
+    for (bit = 0; bit < rx.k; bit++) {
+        if ((coefs & (1UL << bit)) && rx.coefs[bit] != 0) {
+            coefs ^= rx.coefs[bit];
+            rows_xor(data, &rx_rows[bit * rx.symbol_size], rx.symbol_size);
+        }
+    }
+    if (coefs == 0) {
+        return; // Nothing we did not already know
+    }
+    for (bit = 0; !(coefs & (1UL << bit)); bit++) {
+    }
+    rx.coefs[bit] = coefs;
+    memcpy(&rx_rows[bit * rx.symbol_size], data, rx.symbol_size);
+    rx.rank++;
+    if (rx.rank < rx.k) {
+        return;
+    }
+
+    rx_solve();
+    rx.complete = true;
+    dprintf("Generation %u of object %u from "PRINTF_FMT_NODE_ID" complete\n",
+            rx.generation, rx.object, rx.src);
+
+    key = GateMutexPri_enter(GateMutexPri_handle(&bcastMutexStruct));
+    rx.delivering = true;
+    GateMutexPri_leave(GateMutexPri_handle(&bcastMutexStruct), key);
+    rx_deliver_buf.data = rx_rows;
+    rx_deliver_buf.size = sizeof(rx_rows);
+    rx_deliver_buf.len = (size_t) rx.k * rx.symbol_size;
+    if (rx_deliver_buf.len > (rx.size - rx.offset)) {
+        rx_deliver_buf.len = rx.size - rx.offset;
+    }
+    rx_deliver_buf.src = rx.src;
+    rx_deliver_buf.call = rx_deliver;
+    lpmac_rxq_deliver(&rx_deliver_buf);
+}
+
+/**
+ * Answer a poll.
+ *
+ * @param nack Filled in with our answer
+ * @return true if we are short of a generation and must send nack
+ */
+bool lpmac_bcast_poll_rx(node_id_t src, const uint8_t *payload, size_t size,
+        struct bcast_nack *nack) {
+    struct bcast_poll poll;
+    uint16_t need;
+
+    if (bcast_fn == NULL || size < sizeof(poll)) {
+        return false;
+    }
+    memcpy(&poll, payload, sizeof(poll));
+    if (poll.k == 0 || poll.k > BCAST_GENERATION || poll.generation >= poll.generations) {
+        return false;
+    }
+
+    nack->object = poll.object;
+    nack->missing = BCAST_MISSING_ALL;
+    if (rx_delivering()) {
+        // Busy handing over rx.generation, the next one is all we need
+        need = rx.generation + 1;
+        if (need >= poll.generations) {
+            return false;
+        }
+    } else {
+        if (!rx_next(src, poll.object, poll.first)) {
+            return false;
+        }
+        rx.generations = poll.generations;
+        if (rx.complete) {
+            return false;
+        }
+        need = rx.generation;
+        if (rx.k != 0) {
+            nack->missing = rx.k - rx.rank;
+        }
+    }
+    if (need > poll.generation) {
+        return false; // Not sent yet
+    }
+    if (need == poll.generation && nack->missing == BCAST_MISSING_ALL) {
+        nack->missing = poll.k;
+    }
+    nack->generation = need;
+    return true;
+}
@@ -0,0 +1,91 @@
+/**@file lpmac_bcast.h
+ *
+ * Erasure coded reliable broadcast. An object is cut into symbols of
+ * BCAST_SYMBOL_SIZE bytes, and every BCAST_GENERATION symbols form a
+ * generation that is coded on its own. The sender first broadcasts the
+ * symbols themselves, then repair symbols, each the XOR of a random subset
+ * of the generation named by a coefficient bitmask. Any k independent
+ * symbols rebuild a generation of k, so one repair frame stands in for a
+ * different lost frame at every receiver.
+ *
+ * After each round the sender polls. Receivers still short of a generation
+ * answer with a NACK naming the oldest generation they need and how many
+ * symbols they miss, and the sender sends as many repair frames for the
+ * oldest NACKed generation as the worst of them needs. Receivers that are
+ * done stay quiet, so the cost of a round does not grow with the number of
+ * receivers. The sender moves on after BCAST_QUIET_POLLS quiet polls, and a
+ * receiver that fell behind is served by later polls, until the sender
+ * gives up on its generation and tells it so with the first field.
+ *
+ * A receiver buffers one generation and solves it by Gaussian elimination
+ * over GF(2) as symbols arrive, then hands it to the application on the
+ * delivery task. Generations are delivered in order.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_BCAST_H_
+#define LPMAC_LPMAC_BCAST_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+
+/**
+ * The payload of PKT_TYPE_BCAST packets, followed by symbol_size bytes
+ */
+struct bcast_symbol {
+    uint8_t   object      : 8;
+    uint8_t   k           : 8;  // Symbols in this generation
+    uint8_t   symbol_size : 8;
+    uint16_t  generation  : 16;
+    uint16_t  first       : 16; // The oldest generation the sender still repairs
+    uint32_t  offset      : 32; // Of the generation in the object
+    uint32_t  size        : 32; // Of the object
+    uint32_t  coefs       : 32; // The generation's symbols XORed into this one
+} __attribute__((__packed__));
+
+/**
+ * The payload of PKT_TYPE_BCAST_POLL packets
+ */
+struct bcast_poll {
+    uint8_t   object      : 8;
+    uint8_t   k           : 8; // Symbols in the polled generation
+    uint16_t  generation  : 16;
+    uint16_t  first       : 16; // The oldest generation the sender still repairs
+    uint16_t  generations : 16; // In the object
+} __attribute__((__packed__));
+
+/**
+ * The payload of PKT_TYPE_BCAST_NACK packets, sent to the poll's source
+ */
+struct bcast_nack {
+    uint8_t   object     : 8;
+    uint16_t  generation : 16; // The oldest generation we still need
+    uint8_t   missing    : 8;  // Independent symbols still needed, BCAST_MISSING_ALL if unknown
+} __attribute__((__packed__));
+
+#define BCAST_MISSING_ALL 0xFF
+
+void lpmac_bcast_init();
+void lpmac_bcast_listen(bcast_fn_t callback);
+
+uint16_t lpmac_bcast_tx_begin(const uint8_t *obj, size_t size);
+uint8_t lpmac_bcast_k(uint16_t generation);
+size_t lpmac_bcast_symbol(uint16_t generation, uint8_t index, uint8_t *buf, size_t buf_size);
+size_t lpmac_bcast_repair(uint16_t generation, uint8_t *buf, size_t buf_size);
+size_t lpmac_bcast_poll(uint16_t generation, uint8_t *buf, size_t buf_size);
+uint8_t lpmac_bcast_nacks(uint16_t *generation, uint8_t *missing);
+void lpmac_bcast_give_up(uint16_t generation);
+void lpmac_bcast_tx_end();
+
+void lpmac_bcast_symbol_rx(node_id_t src, uint8_t *payload, size_t size);
+bool lpmac_bcast_poll_rx(node_id_t src, const uint8_t *payload, size_t size,
+        struct bcast_nack *nack);
+void lpmac_bcast_nack_rx(node_id_t src, const uint8_t *payload, size_t size);
+
+#endif /* LPMAC_LPMAC_BCAST_H_ */
@@ -0,0 +1,56 @@
+/**@file lpmac_channels.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_channels.h"
+
+static unsigned hop_slot;
+
+/**
+ * @return The center frequency of channel in Hz
+ */
+uint32_t lpmac_channels_freq(uint8_t channel) {
+    return CHANNEL_BASE_FREQ + ((uint32_t) channel * CHANNEL_SPACING);
+}
+
+/**
+ * Pick a node's home channel by hashing its ID.
+ * The rendezvous channel is never used as a home channel.
+ */
+uint8_t lpmac_channels_home(node_id_t node_id) {
+    uint32_t hash = node_id * 2654435761u; // Knuth's multiplicative hash
+    uint8_t channel = (uint8_t) ((hash >> 16) % (CHANNELS_COUNT - 1));
+    if (channel >= CHANNEL_RDV) {
+        channel++;
+    }
+    return channel;
+}
+
+/**
+ * @return The channel to transmit on to reach dst
+ */
+uint8_t lpmac_channels_dst(node_id_t dst, bool broadcast) {
+    return broadcast ? CHANNEL_RDV : lpmac_channels_home(dst);
+}
+
+/**
+ * Advance our listen schedule by one rendezvous dwell.
+ *
+ * @param myid Our node ID
+ * @param hold_home Skip the rendezvous visit, used while waiting for an ACK
+ * @return The channel to listen on until the next hop
+ */
+uint8_t lpmac_channels_hop(node_id_t myid, bool hold_home) {
+    hop_slot = (hop_slot + 1) % CHANNEL_RDV_SLOTS;
+    if (hop_slot == 0 && !hold_home) {
+        return CHANNEL_RDV;
+    }
+    return lpmac_channels_home(myid);
+}
@@ -0,0 +1,28 @@
+/**@file lpmac_channels.h
+ *
+ * Channel plan for multi-channel operation.
+ * Every node receives unicast traffic on a home channel derived from its ID,
+ * and periodically visits the rendezvous channel, where broadcasts are sent.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_CHANNELS_H_
+#define LPMAC_LPMAC_CHANNELS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+
+/** Number of rendezvous dwells in one rendezvous period */
+#define CHANNEL_RDV_SLOTS (CHANNEL_RDV_PERIOD_MS / CHANNEL_RDV_DWELL_MS)
+
+uint32_t lpmac_channels_freq(uint8_t channel);
+uint8_t lpmac_channels_home(node_id_t node_id);
+uint8_t lpmac_channels_dst(node_id_t dst, bool broadcast);
+uint8_t lpmac_channels_hop(node_id_t myid, bool hold_home);
+
+#endif /* LPMAC_LPMAC_CHANNELS_H_ */
@@ -0,0 +1,362 @@
+/**@file lpmac_compress.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_types.h"
+#include "lpmac_neighbors.h"
+#include "lpmac_compress.h"
+
+#define LZ_OFFSET_BITS 10
+#define LZ_OFFSET_MAX  (1 << LZ_OFFSET_BITS)
+#define LZ_LEN_MIN     3
+#define LZ_LEN_MAX     (LZ_LEN_MIN + 63)
+
+#define DICT_NONE 0
+
+typedef struct compress_dict {
+    uint16_t tag; // DICT_NONE when empty
+    uint8_t  len;
+    uint8_t  data[COMPRESS_DICT_SIZE];
+} compress_dict_t;
+
+#ifdef COMPRESS_DICT_ENABLED
+
+typedef struct tx_peer {
+    node_id_t       id;
+    uint32_t        used; // For least recently used replacement
+    compress_dict_t dict;
+} tx_peer_t;
+
+typedef struct rx_peer {
+    node_id_t       id;
+    uint32_t        used;
+    compress_dict_t dicts[2]; // The last frame, then the one before
+} rx_peer_t;
+
+static tx_peer_t tx_peers[COMPRESS_DICT_PEERS];
+static rx_peer_t rx_peers[NEIGHBORS_MAX]; // Any neighbor may send to us
+static uint32_t peers_clock;
+
+/**
+ * FNV-1a folded to 16 bits, never DICT_NONE
+ */
+static uint16_t dict_tag(const uint8_t *data, size_t len) {
+    uint32_t hash = 2166136261UL;
+    uint16_t tag;
+    while (len--) {
+        hash = (hash ^ *data++) * 16777619UL;
+    }
+    tag = (uint16_t) (hash ^ (hash >> 16));
+    return (tag == DICT_NONE) ? 1 : tag;
+}
+
+static void dict_set(compress_dict_t *dict, const uint8_t *data, size_t len) {
+    if (len > COMPRESS_DICT_SIZE) {
+        data += len - COMPRESS_DICT_SIZE;
+        len = COMPRESS_DICT_SIZE;
+    }
+    memcpy(dict->data, data, len);
+    dict->len = (uint8_t) len;
+    dict->tag = (len > 0) ? dict_tag(data, len) : DICT_NONE;
+}
+
+/**
+ * Find a neighbor's dictionary, or with create, take the least recently
+ * used one for it
+ */
+static tx_peer_t *tx_peer_find(node_id_t id, bool create) {
+    size_t index;
+    tx_peer_t *oldest = &tx_peers[0];
+    for (index = 0; index < COMPRESS_DICT_PEERS; index++) {
+        if (tx_peers[index].id == id) {
+            tx_peers[index].used = ++peers_clock;
+            return &tx_peers[index];
+        }
+        if (tx_peers[index].used < oldest->used) {
+            oldest = &tx_peers[index];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->id = id;
+    oldest->used = ++peers_clock;
+    return oldest;
+}
+
+static rx_peer_t *rx_peer_find(node_id_t id, bool create) {
+    size_t index;
+    rx_peer_t *oldest = &rx_peers[0];
+    for (index = 0; index < NEIGHBORS_MAX; index++) {
+        if (rx_peers[index].id == id) {
+            rx_peers[index].used = ++peers_clock;
+            return &rx_peers[index];
+        }
+        if (rx_peers[index].used < oldest->used) {
+            oldest = &rx_peers[index];
+        }
+    }
+    if (!create) {
+        return NULL;
+    }
+    memset(oldest, 0, sizeof(*oldest));
+    oldest->id = id;
+    oldest->used = ++peers_clock;
+    return oldest;
+}
+
+#endif
+
+void lpmac_compress_init() {
+#ifdef COMPRESS_DICT_ENABLED
+    memset(tx_peers, 0, sizeof(tx_peers));
+    memset(rx_peers, 0, sizeof(rx_peers));
+    peers_clock = 0;
+#endif
+}
+
+/**
+ * The byte at index of the dictionary followed by the data
+ */
+static inline uint8_t window_at(const compress_dict_t *dict, const uint8_t *data, size_t index) {
+    return (index < dict->len) ? dict->data[index] : data[index - dict->len];
+}
+
+static size_t lz_encode(const compress_dict_t *dict, const uint8_t *data, size_t len,
+        uint8_t *out, size_t out_size) {
+    size_t pos = 0;
+    size_t op = 0;
+    size_t flags_at = 0;
+    uint8_t item = 8;
+
+    while (pos < len) {
+        size_t here = dict->len + pos;
+        size_t first = (here > LZ_OFFSET_MAX) ? (here - LZ_OFFSET_MAX) : 0;
+        size_t best_len = 0;
+        size_t best_offset = 0;
+        size_t cand;
+
+        // Nearest first, so ties keep the shorter reference
+        for (cand = here; cand-- > first;) {
+            size_t match = 0;
+            while (match < LZ_LEN_MAX && (pos + match) < len
+                    && window_at(dict, data, cand + match) == data[pos + match]) {
+                match++;
+            }
+            if (match > best_len) {
+                best_len = match;
+                best_offset = here - cand;
+                if (match == LZ_LEN_MAX) {
+                    break;
+                }
+            }
+        }
+
+        if (item == 8) {
+            if (op >= out_size) {
+                return 0;
+            }
+            flags_at = op++;
+            out[flags_at] = 0;
+            item = 0;
+        }
+        if (best_len >= LZ_LEN_MIN) {
+            if ((op + 2) > out_size) {
+                return 0;
+            }
+            out[flags_at] |= (uint8_t) (1 << item);
+            out[op++] = (uint8_t) (best_offset - 1);
+            out[op++] = (uint8_t) ((((best_offset - 1) >> 8) << 6) | (best_len - LZ_LEN_MIN));
+            pos += best_len;
+        } else {
+            if (op >= out_size) {
+                return 0;
+            }
+            out[op++] = data[pos++];
+        }
+        item++;
+    }
+    return op;
+}
+
+static size_t lz_decode(const compress_dict_t *dict, const uint8_t *in, size_t in_size,
+        uint8_t *out, size_t len) {
+    size_t ip = 0;
+    size_t pos = 0;
+
+    while (pos < len) {
+        uint8_t flags;
+        uint8_t item;
+        if (ip >= in_size) {
+            return 0;
+        }
+        flags = in[ip++];
+        for (item = 0; item < 8 && pos < len; item++) {
+            if (flags & (1 << item)) {
+                size_t offset;
+                size_t match;
+                size_t from;
+                if ((ip + 2) > in_size) {
+                    return 0;
+                }
+                offset = (in[ip] | ((size_t) (in[ip + 1] >> 6) << 8)) + 1;
+                match = (in[ip + 1] & 0x3F) + LZ_LEN_MIN;
+                ip += 2;
+                if (offset > (dict->len + pos) || (pos + match) > len) {
+                    return 0;
+                }
+                // Byte by byte, a reference may overlap what it produces
+                from = dict->len + pos - offset;
+                while (match--) {
+                    out[pos++] = window_at(dict, out, from++);
+                }
+            } else {
+                if (ip >= in_size) {
+                    return 0;
+                }
+                out[pos++] = in[ip++];
+            }
+        }
+    }
+    return (ip == in_size) ? pos : 0;
+}
+
+/**
+ * Compress a DATA payload.
+ *
+ * @param dict Whether the receiver is dst itself and may use our shared dictionary
+ * @return The compressed payload size, or 0 if it would not be smaller than len
+ */
+size_t lpmac_compress(node_id_t dst, const uint8_t *data, size_t len,
+        uint8_t *out, size_t out_size, bool dict) {
+    compress_dict_t none = { DICT_NONE, 0 };
+    const compress_dict_t *use = &none;
+    pkt_compress_ext_t ext;
+    size_t limit;
+    size_t size;
+
+    if (len <= sizeof(ext) || len > UINT8_MAX) {
+        return 0;
+    }
+#ifdef COMPRESS_DICT_ENABLED
+    if (dict) {
+        tx_peer_t *peer = tx_peer_find(dst, false);
+        if (peer != NULL && peer->dict.tag != DICT_NONE) {
+            use = &peer->dict;
+        }
+    }
+#endif
+
+    // Anything that is not smaller goes as it is
+    limit = len - 1;
+    if (limit > out_size) {
+        limit = out_size;
+    }
+    size = lz_encode(use, data, len, out + sizeof(ext), limit - sizeof(ext));
+    if (size == 0) {
+        return 0;
+    }
+    ext.size = (uint8_t) len;
+    ext.dict = use->tag;
+    memcpy(out, &ext, sizeof(ext));
+    return sizeof(ext) + size;
+}
+
+/**
+ * @return The size a compressed payload decompresses to, or 0 if it is malformed
+ */
+size_t lpmac_compress_size(const uint8_t *payload, size_t size) {
+    pkt_compress_ext_t ext;
+    if (size <= sizeof(ext)) {
+        return 0;
+    }
+    memcpy(&ext, payload, sizeof(ext));
+    return ext.size;
+}
+
+/**
+ * Decompress a DATA payload sent by the neighbor src.
+ *
+ * @return The decompressed size, or 0 if it is malformed or refers to a
+ *         dictionary we do not have
+ */
+size_t lpmac_decompress(node_id_t src, const uint8_t *payload, size_t size,
+        uint8_t *out, size_t out_size) {
+    compress_dict_t none = { DICT_NONE, 0 };
+    const compress_dict_t *use = &none;
+    pkt_compress_ext_t ext;
+
+    if (size <= sizeof(ext)) {
+        return 0;
+    }
+    memcpy(&ext, payload, sizeof(ext));
+    if (ext.size == 0 || ext.size > out_size) {
+        return 0;
+    }
+    if (ext.dict != DICT_NONE) {
+#ifdef COMPRESS_DICT_ENABLED
+        rx_peer_t *peer = rx_peer_find(src, false);
+        if (peer != NULL && peer->dicts[0].tag == ext.dict) {
+            use = &peer->dicts[0];
+        } else if (peer != NULL && peer->dicts[1].tag == ext.dict) {
+            use = &peer->dicts[1];
+        } else {
+            return 0;
+        }
+#else
+        return 0;
+#endif
+    }
+    return lz_decode(use, payload + sizeof(ext), size - sizeof(ext), out, ext.size);
+}
+
+/**
+ * Note that dst received a frame, which becomes our dictionary toward it
+ */
+void lpmac_compress_acked(node_id_t dst, const uint8_t *data, size_t len) {
+#ifdef COMPRESS_DICT_ENABLED
+    tx_peer_t *peer = tx_peer_find(dst, true);
+    dict_set(&peer->dict, data, len);
+#endif
+}
+
+/**
+ * Note that a frame to dst failed. We may be out of step with its
+ * dictionary, so send without one until a frame gets through.
+ */
+void lpmac_compress_failed(node_id_t dst) {
+#ifdef COMPRESS_DICT_ENABLED
+    tx_peer_t *peer = tx_peer_find(dst, false);
+    if (peer != NULL) {
+        peer->dict.tag = DICT_NONE;
+        peer->dict.len = 0;
+    }
+#endif
+}
+
+/**
+ * Note a frame accepted from src, which it will use as its dictionary
+ * once it sees our ACK
+ */
+void lpmac_compress_received(node_id_t src, const uint8_t *data, size_t len) {
+#ifdef COMPRESS_DICT_ENABLED
+    rx_peer_t *peer = rx_peer_find(src, true);
+    compress_dict_t dict;
+    dict_set(&dict, data, len);
+    if (dict.tag == peer->dicts[0].tag) {
+        // A resend after our ACK was lost, keep the frame before it too
+        return;
+    }
+    peer->dicts[1] = peer->dicts[0];
+    peer->dicts[0] = dict;
+#endif
+}
@@ -0,0 +1,42 @@
+/**@file lpmac_compress.h
+ *
+ * DATA payload compression. Payloads are coded as LZSS: a flag byte
+ * announces each group of eight items, which are literal bytes or two byte
+ * back references of up to 1024 bytes back and 3 to 66 bytes long.
+ *
+ * With COMPRESS_DICT_ENABLED references may also reach into the end of the
+ * last frame exchanged between the two hops, which is where repetitive
+ * telemetry saves the most. The sender only uses a frame the receiver
+ * acknowledged, and the receiver keeps its last two frames per neighbor, so
+ * a lost ACK does not leave them out of step. The MAC resends a frame
+ * without the dictionary after its first timeout, in case the receiver
+ * lost it, and a sender that fails to get a frame through forgets its
+ * dictionary and starts over without one.
+ *
+ * Everything here runs on the MAC task, so there is no locking.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_COMPRESS_H_
+#define LPMAC_LPMAC_COMPRESS_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_types.h"
+
+void lpmac_compress_init();
+size_t lpmac_compress(node_id_t dst, const uint8_t *data, size_t len,
+        uint8_t *out, size_t out_size, bool dict);
+size_t lpmac_compress_size(const uint8_t *payload, size_t size);
+size_t lpmac_decompress(node_id_t src, const uint8_t *payload, size_t size,
+        uint8_t *out, size_t out_size);
+void lpmac_compress_acked(node_id_t dst, const uint8_t *data, size_t len);
+void lpmac_compress_failed(node_id_t dst);
+void lpmac_compress_received(node_id_t src, const uint8_t *data, size_t len);
+
+#endif /* LPMAC_LPMAC_COMPRESS_H_ */
@@ -10,10 +10,89 @@
 
 #define RETRIES_MAX        3
 #define RETRIES_TIMEOUT_MS 1000
+#define ANSWER_SPREAD_MS   1000 // Answers to a broadcast are spread over this time
+#define BUSY_RETRIES_MAX   8    // Resends to a receiver that answered busy, not counted as retries
+#define BUSY_BACKOFF_MS    2000 // Wait this long before resending to a busy receiver
 
 #define LBT_ENABLED
 #define ID_FILTER_ENABLED
 
+#define NEIGHBORS_VERIFY_MS         600000 // Drop restored neighbors not heard within this time
+#define NEIGHBORS_RESTORE_AGE_MAX_S 86400  // Do not restore neighbors that were already this stale
+
+#define RXQ_BUFFERS         4    // MAC owned receive buffers, lent to the rx callback
+#define RXQ_BUFFER_SIZE     256
+#define RXQ_APP_BUFFERS_MAX 8    // Application buffers that can be posted at once
+#define RXQ_TASK_STACKSIZE  1024 // The delivery task runs the rx callback
+#define RXQ_TASK_PRIORITY   1
+
+#define TXQ_FLOWS_MAX      8   // Destinations that can be queued per priority class
+#define TXQ_QUANTUM        256 // Bytes each destination may send per round robin turn
+
+#define TIMERS_TICK_MS 10 // Timer resolution, timers due in the same tick share a wakeup
+#define TIMERS_LEVELS  4  // Wheel levels of 32 slots, 4 reach 2^20 ticks
+
+/* DATA payload compression, skipped for frames it does not shrink */
+#define COMPRESS_ENABLED
+#define COMPRESS_DICT_ENABLED   // Also refer back into the last frame exchanged with each neighbor
+#define COMPRESS_DICT_SIZE  64  // Bytes kept from the end of that frame
+#define COMPRESS_DICT_PEERS 4   // Neighbors we keep a dictionary toward, we keep one from every neighbor
+
+/* Counters and histograms, see LPMAC_GetStats */
+#define STATS_ENABLED
+#define STATS_NEIGHBORS_MAX 16
+
+/* Radio energy accounting, see LPMAC_GetEnergy. Defaults are SX1276 datasheet typicals. */
+#define ENERGY_ENABLED
+#define ENERGY_SUPPLY_MV   3300
+#define ENERGY_SLEEP_UA    1
+#define ENERGY_STANDBY_UA  1600
+#define ENERGY_RX_UA       11500
+#define ENERGY_CAD_UA      11500
+// TX current by output power, ascending in dBm. The first entry at or above
+// TX_OUTPUT_POWER is used, the last if there is none.
+#define ENERGY_TX_UA_TABLE { \
+    {  7,  20000 }, \
+    { 13,  29000 }, \
+    { 17,  87000 }, \
+    { 20, 120000 }, \
+}
+
+/* Timestamped event trace, see LPMAC_TraceDump and tools/lpmac_trace.py */
+//#define TRACE_ENABLED
+#define TRACE_BUFFER_SIZE  2048 // Bytes, a record takes 12 plus its captured bytes
+#define TRACE_CAPTURE_MAX  32   // Frame bytes kept per TX and RX record
+
+/* RTS/CTS reservation before large packets, with virtual carrier sense */
+//#define RTSCTS_ENABLED
+#define RTS_THRESHOLD      64  // Payload bytes above which RTS/CTS is used
+#define RTS_TURNAROUND_MS  30  // Allowance per packet for CAD and processing
+#define CTS_TIMEOUT_MS     300
+
+/* Multi-hop forwarding over ETX distance-vector routes */
+//#define MESH_ENABLED
+#define MESH_HOPS_MAX      4
+#define ROUTES_MAX         16
+#define ROUTES_TIMEOUT_MS  600000 // Drop routes not re-advertised in this time
+#define ROUTES_ADVERT_MS   150000 // Re-advertise routes this often, give or take a quarter
+
+#if (ROUTES_ADVERT_MS + (ROUTES_ADVERT_MS / 4)) >= ROUTES_TIMEOUT_MS
+#   error "Routes must be re-advertised before they time out."
+#endif
+
+/* Erasure coded reliable broadcast of large objects, see LPMAC_Broadcast */
+//#define BCAST_ENABLED
+#define BCAST_SYMBOL_SIZE    128  // Object bytes per frame
+#define BCAST_GENERATION     16   // Symbols coded together, receivers buffer this many
+#define BCAST_REPAIR_EXTRA   2    // Repair frames beyond what the worst NACK asks for
+#define BCAST_POLL_WINDOW_MS 1500 // Must cover ANSWER_SPREAD_MS
+#define BCAST_QUIET_POLLS    3    // Polls nobody NACKs before the next generation
+#define BCAST_ROUNDS_MAX     8    // Repair rounds without headway before giving up on a generation
+
+#if defined( BCAST_ENABLED ) && (BCAST_GENERATION > 32)
+#   error "A broadcast generation is at most 32 symbols."
+#endif
+
 #define USE_BAND_915
 #define USE_MODEM_LORA
 //#define USE_MODEM_FSK
@@ -39,6 +118,42 @@
 #   error "Please define a frequency band in the compiler options."
 #endif
 
+/* Multi-channel operation, each node receives on a home channel picked from its ID */
+//#define MULTICHANNEL_ENABLED
+#define CHANNELS_COUNT        64
+#define CHANNEL_BASE_FREQ     902300000 // Hz
+#define CHANNEL_SPACING       200000    // Hz
+#define CHANNEL_RDV           0         // Rendezvous channel, used for broadcasts
+#define CHANNEL_RDV_PERIOD_MS 2000
+#define CHANNEL_RDV_DWELL_MS  500       // Time per period spent on the rendezvous channel
+
+#if defined( MULTICHANNEL_ENABLED ) && !defined( USE_BAND_915 )
+#   error "Multi-channel operation is only defined for the 915 band."
+#endif
+#if defined( MULTICHANNEL_ENABLED ) && defined( TDMA_ENABLED )
+#   error "TDMA beacons need every member on one channel, at a known time."
+#endif
+
+/* Low power listening, sleep and wake up every interval to sample with CAD */
+//#define LPL_ENABLED
+#define LPL_WAKE_INTERVAL_MS  500    // Longer saves energy, shorter lowers latency
+#define LPL_GUARD_MS          10     // Margin around a neighbor's learned wake time
+#define LPL_DRIFT_PPM         40     // Worst case clock drift between two nodes
+#define LPL_PHASE_VALID_MS    600000 // Relearn a wake phase after this time
+#define LPL_ANSWER_WINDOW_MS  2000   // Stay up this long for the answers to a JOIN or poll
+
+#if defined( LPL_ENABLED ) && !defined( USE_MODEM_LORA )
+#   error "Low power listening needs the LoRa modem for CAD."
+#endif
+
+/* Beacon synchronized TDMA, for dense clusters around a coordinator */
+//#define TDMA_ENABLED
+#define TDMA_SLOT_MS           500 // Must fit the largest packet and its ACK
+#define TDMA_SLOTS_MAX         16
+#define TDMA_GUARD_MS          20
+#define TDMA_SYNC_LOST_BEACONS 4   // Fall back to contention after missing this many
+#define TDMA_DRIFT_PPM_MAX     100 // Crystal tolerance, drift samples beyond it are mistimed beacons
+
 #if defined( USE_MODEM_LORA )
 
 #define LORA_BANDWIDTH                              0         // [0: 125 kHz,
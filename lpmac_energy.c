@@ -0,0 +1,159 @@
+/**@file lpmac_energy.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "board.h"
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_energy_errors.h"
+#include "lpmac_stats.h"
+#include "lpmac_energy.h"
+
+#ifdef ENERGY_ENABLED
+
+#define MS_PER_DAY 86400000ULL
+
+typedef struct energy_tx_current {
+    int8_t   dbm;
+    uint32_t ua;
+} energy_tx_current_t;
+
+static const energy_tx_current_t tx_currents[] = ENERGY_TX_UA_TABLE;
+#define TX_CURRENTS_COUNT (sizeof(tx_currents) / sizeof(tx_currents[0]))
+
+static uint32_t state_ua[LPMAC_RADIO_STATE_COUNT] = {
+    ENERGY_SLEEP_UA, ENERGY_STANDBY_UA, ENERGY_RX_UA, 0, ENERGY_CAD_UA
+};
+
+static lpmac_radio_state_t state;
+static uint32_t state_ticks;   // When we entered state
+static node_id_t tx_dst;       // Destination of the transmission in progress
+static uint32_t reset_ticks;
+static uint64_t ticks[LPMAC_RADIO_STATE_COUNT];
+static uint64_t charge_nc[LPMAC_RADIO_STATE_COUNT]; // uA * ms
+
+/**
+ * @return The current for the lowest table entry at or above dbm
+ */
+static uint32_t tx_current(int8_t dbm) {
+    size_t index;
+    for (index = 0; index < TX_CURRENTS_COUNT; index++) {
+        if (tx_currents[index].dbm >= dbm) {
+            return tx_currents[index].ua;
+        }
+    }
+    return tx_currents[TX_CURRENTS_COUNT - 1].ua;
+}
+
+static uint64_t nc_to_uj(uint64_t nc) {
+    return (nc * ENERGY_SUPPLY_MV) / 1000000;
+}
+
+void lpmac_energy_init(int8_t tx_power) {
+    state_ua[LPMAC_RADIO_TX] = tx_current(tx_power);
+    state = LPMAC_RADIO_SLEEP;
+    lpmac_energy_reset();
+}
+
+void lpmac_energy_reset() {
+    UInt key = Hwi_disable();
+    memset(ticks, 0, sizeof(ticks));
+    memset(charge_nc, 0, sizeof(charge_nc));
+    reset_ticks = state_ticks = Clock_getTicks();
+    Hwi_restore(key);
+}
+
+/**
+ * Close the time spent in the current state. Must be called with interrupts disabled.
+ *
+ * @return The charge used in the closed period, in nC
+ */
+static uint64_t energy_close(uint32_t now) {
+    uint32_t elapsed = now - state_ticks;
+    uint64_t charge = ((uint64_t) elapsed * state_ua[state]) / TIME_MS;
+    ticks[state] += elapsed;
+    charge_nc[state] += charge;
+    state_ticks = now;
+    return charge;
+}
+
+static void energy_enter(lpmac_radio_state_t next, node_id_t next_dst) {
+    uint64_t charge;
+    node_id_t dst = 0;
+
+    UInt key = Hwi_disable();
+    charge = energy_close(Clock_getTicks());
+    if (state == LPMAC_RADIO_TX) {
+        dst = tx_dst;
+    }
+    state = next;
+    tx_dst = next_dst;
+    Hwi_restore(key);
+
+    if (dst != 0) {
+        lpmac_stats_neighbor_add(dst, STATS_NEIGHBOR_TX_ENERGY_UJ, (uint32_t) nc_to_uj(charge));
+    }
+}
+
+/**
+ * Record that the radio was just put into a new state
+ */
+void lpmac_energy_state(lpmac_radio_state_t next) {
+    energy_enter(next, 0);
+}
+
+/**
+ * Record the start of a transmission, whose energy goes to dst, or nobody if 0
+ */
+void lpmac_energy_tx(node_id_t dst) {
+    energy_enter(LPMAC_RADIO_TX, dst);
+}
+
+void lpmac_energy_get(lpmac_energy_t *energy) {
+    size_t index;
+    uint32_t uptime_ms;
+
+    UInt key = Hwi_disable();
+    energy_close(Clock_getTicks());
+    uptime_ms = (state_ticks - reset_ticks) / TIME_MS;
+    energy->total_uj = 0;
+    for (index = 0; index < LPMAC_RADIO_STATE_COUNT; index++) {
+        energy->time_ms[index] = (uint32_t) (ticks[index] / TIME_MS);
+        energy->energy_uj[index] = nc_to_uj(charge_nc[index]);
+        energy->total_uj += energy->energy_uj[index];
+    }
+    Hwi_restore(key);
+
+    energy->uptime_ms = uptime_ms;
+    energy->mj_per_day = (uptime_ms > 0)
+            ? (uint32_t) ((energy->total_uj * MS_PER_DAY) / ((uint64_t) uptime_ms * 1000))
+            : 0;
+}
+
+void lpmac_energy_show() {
+    static const char *names[LPMAC_RADIO_STATE_COUNT] = {
+        "Sleep", "Standby", "RX", "TX", "CAD"
+    };
+    lpmac_energy_t energy;
+    size_t index;
+
+    lpmac_energy_get(&energy);
+    dprintf("Energy over %lu ms\n", energy.uptime_ms);
+    for (index = 0; index < LPMAC_RADIO_STATE_COUNT; index++) {
+        dprintf("%s: %lu ms, %lu uJ\n", names[index], energy.time_ms[index],
+                (uint32_t) energy.energy_uj[index]);
+    }
+    dprintf("Total %lu uJ, about %lu mJ/day\n", (uint32_t) energy.total_uj,
+            energy.mj_per_day);
+}
+
+#endif
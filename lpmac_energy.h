@@ -0,0 +1,39 @@
+/**@file lpmac_energy.h
+ *
+ * Radio energy accounting. The MAC reports every radio state change,
+ * and the time in each state is integrated against the current draw
+ * tables in lpmac_config.h. Transmit energy is also attributed to the
+ * destination, in the per neighbor stats.
+ * Without ENERGY_ENABLED the accounting compiles away.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_ENERGY_H_
+#define LPMAC_LPMAC_ENERGY_H_
+
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+
+#ifdef ENERGY_ENABLED
+
+void lpmac_energy_init(int8_t tx_power);
+void lpmac_energy_reset();
+void lpmac_energy_state(lpmac_radio_state_t state);
+void lpmac_energy_tx(node_id_t dst);
+void lpmac_energy_get(lpmac_energy_t *energy);
+void lpmac_energy_show();
+
+#else
+
+static inline void lpmac_energy_init(int8_t tx_power) {}
+static inline void lpmac_energy_reset() {}
+static inline void lpmac_energy_state(lpmac_radio_state_t state) {}
+static inline void lpmac_energy_tx(node_id_t dst) {}
+
+#endif
+
+#endif /* LPMAC_LPMAC_ENERGY_H_ */
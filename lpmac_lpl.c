@@ -0,0 +1,144 @@
+/**@file lpmac_lpl.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/gates/GateMutexPri.h>
+
+#include "board.h"
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_lpl.h"
+
+#define PHASE_ID_BLANK ((node_id_t)0x00000000)
+
+/**
+ * What we know about a neighbor's wake schedule
+ */
+typedef struct phase_entry {
+    node_id_t id;
+    uint32_t  wake;    // Clock ticks of one of its past wake ups
+    uint32_t  learned; // Clock ticks when wake was learned
+} phase_entry_t;
+static phase_entry_t phases[LPL_PHASES_MAX];
+static size_t phases_next;
+
+static uint32_t last_wake; // Clock ticks of our last wake up
+
+static phase_entry_t *phases_find(node_id_t id) {
+    size_t index;
+    for (index = 0; index < LPL_PHASES_MAX; index++) {
+        if (phases[index].id == id) {
+            return &phases[index];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @return The number of LoRa symbols that last at least ms
+ */
+uint16_t lpmac_lpl_symbols(uint32_t ms) {
+    static const uint32_t bandwidths[] = { 125000, 250000, 500000 };
+    uint32_t symbol_us = ((1UL << LORA_SPREADING_FACTOR) * 1000000UL)
+            / bandwidths[LORA_BANDWIDTH];
+    uint32_t symbols = ((ms * 1000UL) + symbol_us - 1) / symbol_us;
+    if (symbols > UINT16_MAX) {
+        symbols = UINT16_MAX;
+    }
+    return (uint16_t) symbols;
+}
+
+/**
+ * @return The preamble length that spans a whole wake interval
+ */
+uint16_t lpmac_lpl_preamble_long() {
+    return lpmac_lpl_symbols(LPL_WAKE_INTERVAL_MS + LPL_GUARD_MS)
+            + LORA_PREAMBLE_LENGTH;
+}
+
+/**
+ * Note that we just woke up to sample the channel
+ */
+void lpmac_lpl_woke() {
+    last_wake = Clock_getTicks();
+}
+
+/**
+ * @return The time in ms until our next wake up
+ */
+lpl_stamp_t lpmac_lpl_stamp() {
+    uint32_t since = (Clock_getTicks() - last_wake) / TIME_MS;
+    return (lpl_stamp_t) (LPL_WAKE_INTERVAL_MS - (since % LPL_WAKE_INTERVAL_MS));
+}
+
+/**
+ * Learn a neighbor's wake phase from the stamp in its ACK.
+ *
+ * @param node_id The neighbor that sent the ACK
+ * @param stamp The stamp carried in the ACK
+ * @param airtime_ms The airtime of the ACK, which delayed the stamp
+ */
+void lpmac_lpl_learn(node_id_t node_id, lpl_stamp_t stamp, uint32_t airtime_ms) {
+    uint32_t now = Clock_getTicks();
+    phase_entry_t *entry = phases_find(node_id);
+    if (entry == NULL) {
+        entry = &phases[phases_next];
+        phases_next = (phases_next + 1) % LPL_PHASES_MAX;
+    }
+    entry->id = node_id;
+    // Kept as the wake up before that one, so that schedule only ever
+    // measures time since a wake up in the past
+    entry->wake = now + ((uint32_t) (stamp % LPL_WAKE_INTERVAL_MS) * TIME_MS)
+            - (airtime_ms * TIME_MS) - (LPL_WAKE_INTERVAL_MS * TIME_MS);
+    entry->learned = now;
+}
+
+void lpmac_lpl_forget(node_id_t node_id) {
+    phase_entry_t *entry = phases_find(node_id);
+    if (entry != NULL) {
+        entry->id = PHASE_ID_BLANK;
+    }
+}
+
+/**
+ * Plan a transmission to dst.
+ * If we know when dst wakes, delay_ms is set to the time to wait so that
+ * the frame starts just before dst samples the channel.
+ * Otherwise delay_ms is left alone and a long preamble is used.
+ *
+ * @param dst The destination
+ * @param[out] delay_ms The time to wait before transmitting
+ * @return The preamble length to use in symbols
+ */
+uint16_t lpmac_lpl_schedule(node_id_t dst, uint32_t *delay_ms) {
+    uint32_t now = Clock_getTicks();
+    uint32_t elapsed, guard, since, until;
+    phase_entry_t *entry = phases_find(dst);
+
+    if (entry == NULL) {
+        return lpmac_lpl_preamble_long();
+    }
+
+    // Both clocks may drift apart since we learned the phase
+    elapsed = (now - entry->learned) / TIME_MS;
+    guard = LPL_GUARD_MS + (uint32_t) (((uint64_t) elapsed * LPL_DRIFT_PPM) / 1000000UL);
+    if (elapsed > LPL_PHASE_VALID_MS || (2 * guard) >= LPL_WAKE_INTERVAL_MS) {
+        entry->id = PHASE_ID_BLANK;
+        return lpmac_lpl_preamble_long();
+    }
+
+    since = ((now - entry->wake) / TIME_MS) % LPL_WAKE_INTERVAL_MS;
+    until = LPL_WAKE_INTERVAL_MS - since;
+    if (until < guard) {
+        until += LPL_WAKE_INTERVAL_MS;
+    }
+    *delay_ms = until - guard;
+    return lpmac_lpl_symbols(2 * guard) + LORA_PREAMBLE_LENGTH;
+}
@@ -0,0 +1,33 @@
+/**@file lpmac_lpl.h
+ *
+ * Low power listening. Receivers sleep and wake every LPL_WAKE_INTERVAL_MS
+ * to run a CAD, so senders stretch the preamble to span a wake interval.
+ * Receivers stamp their wake phase into ACKs, which lets senders time
+ * later frames to a neighbor's wake up and use a short preamble.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_LPL_H_
+#define LPMAC_LPMAC_LPL_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+
+#define LPL_PHASES_MAX 12
+
+/** The wake phase stamp carried as the payload of ACKs */
+typedef uint16_t lpl_stamp_t;
+
+uint16_t lpmac_lpl_symbols(uint32_t ms);
+uint16_t lpmac_lpl_preamble_long();
+void lpmac_lpl_woke();
+lpl_stamp_t lpmac_lpl_stamp();
+void lpmac_lpl_learn(node_id_t node_id, lpl_stamp_t stamp, uint32_t airtime_ms);
+void lpmac_lpl_forget(node_id_t node_id);
+uint16_t lpmac_lpl_schedule(node_id_t dst, uint32_t *delay_ms);
+
+#endif /* LPMAC_LPMAC_LPL_H_ */
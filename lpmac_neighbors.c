@@ -5,27 +5,120 @@
  */
 
 #include <stdbool.h>
-#include <ti/sysbios/gates/GateMutexPri.h>
+#include <string.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "board.h"
 
 #include "lpmac.h"
+#include "lpmac_config.h"
 #include "lpmac_neighbors_errors.h"
 #include "lpmac_neighbors.h"
 
 #define NEIGHBOR_ID_BLANK ((node_id_t)0x00000000)
 
+/*
+ * The table is a seqlock. Writers keep interrupts disabled for their short
+ * updates and bump table_seq before and after, so it is odd while an update
+ * is in progress. Readers copy what they need and retry if table_seq moved,
+ * so the receive path and readers never wait on a lock.
+ * Neighbor events are queued by writers and delivered later, outside of
+ * any critical section, by lpmac_neighbors_docallbacks.
+ */
+#if defined(__GNUC__)
+#define seq_barrier() __asm volatile ("" ::: "memory")
+#else
+// The TI compiler does not move memory accesses across asm statements
+#define seq_barrier() __asm(" ")
+#endif
+
 typedef struct table_entry {
-    node_id_t id;
+    node_id_t      id;
+    link_quality_t link_quality;
+    uint16_t       etx;
+    uint32_t       heard;    // Clock ticks when last heard, or restored
+    bool           verified; // Heard since it was restored from storage
 } table_entry_t;
 static table_entry_t table[NEIGHBORS_MAX];
+static volatile uint32_t table_seq;
+
+typedef struct pending_event {
+    neighbor_event_t type;
+    node_id_t        id;
+    link_quality_t   link_quality;
+} pending_event_t;
+static pending_event_t pending[NEIGHBORS_EVENTS_MAX];
+static size_t pending_head;
+static size_t pending_count;
+static uint32_t pending_lost;
 
 static neighbor_event_fn_t neighbor_update_fn;
-static GateMutexPri_Struct tableMutexStruct;
+static void (*neighbor_pending_fn)();
 
-void lpmac_neighbors_init(neighbor_event_fn_t neighbor_updates_callback) {
+void lpmac_neighbors_init(neighbor_event_fn_t neighbor_updates_callback,
+        void (*events_pending_callback)()) {
 	neighbor_update_fn = neighbor_updates_callback;
-	GateMutexPri_construct(&tableMutexStruct, NULL);
+	neighbor_pending_fn = events_pending_callback;
+}
+
+static UInt write_begin() {
+    UInt key = Hwi_disable();
+    table_seq++;
+    seq_barrier();
+    return key;
+}
+
+static void write_end(UInt key) {
+    seq_barrier();
+    table_seq++;
+    Hwi_restore(key);
 }
 
+/**
+ * Copy the whole table, consistently, without blocking writers
+ */
+static void table_copy(table_entry_t *copy) {
+    uint32_t seq;
+    do {
+        while ((seq = table_seq) & 1) {
+        }
+        seq_barrier();
+        memcpy(copy, table, sizeof(table));
+        seq_barrier();
+    } while (seq != table_seq);
+}
+
+/**
+ * Copy the entry for id, consistently, without blocking writers
+ *
+ * @return true if id is in the table
+ */
+static bool table_lookup(node_id_t id, table_entry_t *entry) {
+    uint32_t seq;
+    bool found;
+    size_t index;
+    do {
+        while ((seq = table_seq) & 1) {
+        }
+        seq_barrier();
+        found = false;
+        for (index = 0; index < NEIGHBORS_MAX; index++) {
+            if (table[index].id == id) {
+                *entry = table[index];
+                found = true;
+                break;
+            }
+        }
+        seq_barrier();
+    } while (seq != table_seq);
+    return found;
+}
+
+/*
+ * The following table_ functions must be called inside a write section
+ */
+
 static table_entry_t *table_find(node_id_t id) {
     size_t index;
     for (index = 0; index < NEIGHBORS_MAX; index++) {
@@ -61,35 +154,90 @@ static void table_clear() {
     }
 }
 
+/**
+ * Queue a neighbor event for lpmac_neighbors_docallbacks
+ */
+static void table_event(neighbor_event_t type, node_id_t id, link_quality_t link_quality) {
+    pending_event_t *event;
+    if (pending_count == NEIGHBORS_EVENTS_MAX) {
+        pending_lost++;
+        return;
+    }
+    event = &pending[(pending_head + pending_count++) % NEIGHBORS_EVENTS_MAX];
+    event->type = type;
+    event->id = id;
+    event->link_quality = link_quality;
+}
 
+static uint16_t crc16(uint16_t crc, const uint8_t *buf, size_t size) {
+    size_t bit;
+    while (size-- > 0) {
+        crc ^= (uint16_t) (*buf++) << 8;
+        for (bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x8000) ? (uint16_t) ((crc << 1) ^ 0x1021) : (uint16_t) (crc << 1);
+        }
+    }
+    return crc;
+}
+
+static void events_pending() {
+    if (neighbor_pending_fn != NULL) {
+        neighbor_pending_fn();
+    }
+}
 
 void lpmac_neighbors_clear() {
-	UInt key =  GateMutexPri_enter(GateMutexPri_handle(&tableMutexStruct));
+	UInt key = write_begin();
 	table_clear();
-	GateMutexPri_leave(GateMutexPri_handle(&tableMutexStruct), key);
+	write_end(key);
 }
 
 void lpmac_neighbors_add(node_id_t node_id, link_quality_t link_quality) {
-	UInt key = GateMutexPri_enter(GateMutexPri_handle(&tableMutexStruct));
-	if(table_find(node_id) == NULL) {
-	    table_entry_t entry = { .id = node_id };
-	    if(!table_add(&entry)) {
-	        dprintf("Neighbor Table Full\n");
+	bool added = false;
+	UInt key = write_begin();
+	table_entry_t *existing = table_find(node_id);
+	if(existing == NULL) {
+	    table_entry_t entry = {
+	            .id = node_id,
+	            .link_quality = link_quality,
+	            .etx = NEIGHBOR_ETX_ONE,
+	            .heard = Clock_getTicks(),
+	            .verified = true
+	    };
+	    if(table_add(&entry)) {
+	        table_event(NEIGHBOR_EVENT_ADD, node_id, link_quality);
+	        added = true;
 	    }
-	    neighbor_update_fn(NEIGHBOR_EVENT_ADD, node_id, link_quality);
+	} else {
+	    existing->link_quality = link_quality;
+	    existing->heard = Clock_getTicks();
+	    existing->verified = true;
+	}
+	write_end(key);
+	if (added) {
+	    events_pending();
+	} else if (existing == NULL) {
+	    dprintf("Neighbor Table Full\n");
 	}
-	GateMutexPri_leave(GateMutexPri_handle(&tableMutexStruct), key);
 }
 
 void lpmac_neighbors_rem(node_id_t node_id) {
-	UInt key = GateMutexPri_enter(GateMutexPri_handle(&tableMutexStruct));
-	if(table_rem(node_id)) {
-	    neighbor_update_fn(NEIGHBOR_EVENT_REM, node_id, 0);
+	bool removed;
+	UInt key = write_begin();
+	removed = table_rem(node_id);
+	if(removed) {
+	    table_event(NEIGHBOR_EVENT_REM, node_id, 0);
+	}
+	write_end(key);
+	if (removed) {
+	    events_pending();
 	}
-	GateMutexPri_leave(GateMutexPri_handle(&tableMutexStruct), key);
-	return;
 }
 
+/**
+ * Note a frame from node_id. This runs in the radio callback for every
+ * received frame, so it only ever takes a short write section.
+ */
 void lpmac_neighbors_heard(node_id_t node_id, link_quality_t link_quality) {
     dprintf("Overheard pkt from "PRINTF_FMT_NODE_ID"\n", node_id);
     lpmac_neighbors_add(node_id, link_quality);
@@ -100,21 +248,269 @@ void lpmac_neighbors_failed(node_id_t node_id) {
     return;
 }
 
+/**
+ * Record a delivered frame to update the link's ETX estimate.
+ * The estimate is an EWMA of attempts per delivered frame.
+ *
+ * @param node_id The neighbor that acknowledged the frame
+ * @param attempts The number of transmissions it took, including the first
+ */
+void lpmac_neighbors_acked(node_id_t node_id, unsigned attempts) {
+    UInt key = write_begin();
+    table_entry_t *entry = table_find(node_id);
+    if (entry != NULL) {
+        uint32_t sample = attempts * NEIGHBOR_ETX_ONE;
+        entry->etx = (uint16_t) (entry->etx - (entry->etx / 4) + (sample / 4));
+        if (entry->etx < NEIGHBOR_ETX_ONE) {
+            entry->etx = NEIGHBOR_ETX_ONE;
+        }
+    }
+    write_end(key);
+}
+
+/**
+ * @return The ETX of the link to node_id, or 0 if it is not a neighbor
+ */
+uint16_t lpmac_neighbors_etx(node_id_t node_id) {
+    table_entry_t entry;
+    if (node_id == NEIGHBOR_ID_BLANK || !table_lookup(node_id, &entry)) {
+        return 0;
+    }
+    return entry.etx;
+}
+
+/**
+ * Fetch the neighbor stored in table slot index.
+ *
+ * @return true if the slot holds a neighbor, false if it is blank or out of range
+ */
+bool lpmac_neighbors_at(size_t index, node_id_t *node_id, uint16_t *etx) {
+    table_entry_t entry;
+    uint32_t seq;
+    if (index >= NEIGHBORS_MAX) {
+        return false;
+    }
+    do {
+        while ((seq = table_seq) & 1) {
+        }
+        seq_barrier();
+        entry = table[index];
+        seq_barrier();
+    } while (seq != table_seq);
+    if (entry.id == NEIGHBOR_ID_BLANK) {
+        return false;
+    }
+    *node_id = entry.id;
+    *etx = entry.etx;
+    return true;
+}
+
+/**
+ * Copy the neighbor table.
+ *
+ * @param neighbors Array to fill
+ * @param max Number of entries neighbors can hold
+ * @return The number of neighbors copied
+ */
+size_t lpmac_neighbors_snapshot(lpmac_neighbor_t *neighbors, size_t max) {
+    table_entry_t copy[NEIGHBORS_MAX];
+    uint32_t now = Clock_getTicks();
+    size_t count = 0;
+    size_t index;
+
+    table_copy(copy);
+    for (index = 0; index < NEIGHBORS_MAX && count < max; index++) {
+        if (copy[index].id != NEIGHBOR_ID_BLANK) {
+            neighbors[count].id = copy[index].id;
+            neighbors[count].link_quality = copy[index].link_quality;
+            neighbors[count].etx = copy[index].etx;
+            neighbors[count].heard_ms = (now - copy[index].heard) / TIME_MS;
+            neighbors[count].verified = copy[index].verified;
+            count++;
+        }
+    }
+    return count;
+}
+
 void lpmac_neighbors_show() {
+    table_entry_t copy[NEIGHBORS_MAX];
     size_t index;
     size_t count = 0;
-    UInt key = GateMutexPri_enter(GateMutexPri_handle(&tableMutexStruct));
+    table_copy(copy);
     for (index = 0; index < NEIGHBORS_MAX; index++)
     {
-        if(table[index].id != NEIGHBOR_ID_BLANK) {
+        if(copy[index].id != NEIGHBOR_ID_BLANK) {
             count++;
-            dprintf("Neighbor %lu: 0x"PRINTF_FMT_NODE_ID"\n", count, table[index].id);
+            dprintf("Neighbor %lu: 0x"PRINTF_FMT_NODE_ID"%s\n", count, copy[index].id,
+                    copy[index].verified ? "" : " (restored)");
         }
     }
     dprintf("Neighbor List Complete - Total %lu\n", count);
-    GateMutexPri_leave(GateMutexPri_handle(&tableMutexStruct), key);
 }
 
+/**
+ * Save the neighbor table to storage, so a reboot can skip discovery.
+ *
+ * @param owner Our ID, restore only accepts snapshots we saved
+ * @return true if the snapshot was written
+ */
+bool lpmac_neighbors_save(const lpmac_storage_t *storage, node_id_t owner) {
+    uint8_t buf[NEIGHBORS_SNAPSHOT_MAX];
+    table_entry_t copy[NEIGHBORS_MAX];
+    struct neighbors_snapshot_hdr hdr;
+    struct neighbors_snapshot_entry entry;
+    uint32_t now = Clock_getTicks();
+    size_t count = 0;
+    size_t size;
+    size_t index;
+
+    table_copy(copy);
+    for (index = 0; index < NEIGHBORS_MAX; index++) {
+        if (copy[index].id != NEIGHBOR_ID_BLANK) {
+            entry.id = copy[index].id;
+            entry.link_quality = copy[index].link_quality;
+            entry.etx = copy[index].etx;
+            entry.age_s = (now - copy[index].heard) / (TIME_MS * 1000);
+            memcpy(buf + NEIGHBORS_SNAPSHOT_CALC_SIZE(count++), &entry, sizeof(entry));
+        }
+    }
+
+    hdr.magic = NEIGHBORS_SNAPSHOT_MAGIC;
+    hdr.version = NEIGHBORS_SNAPSHOT_VERSION;
+    hdr.count = (uint8_t) count;
+    hdr.crc = 0;
+    hdr.owner = owner;
+    memcpy(buf, &hdr, sizeof(hdr));
+    size = NEIGHBORS_SNAPSHOT_CALC_SIZE(count);
+    hdr.crc = crc16(0xFFFF, buf, size);
+    memcpy(buf, &hdr, sizeof(hdr));
+
+    dprintf("Saving %lu neighbors\n", count);
+    return storage->write(storage, buf, size);
+}
+
+/**
+ * Restore a neighbor table snapshot. The snapshot is ignored unless it is
+ * intact and ours. Restored neighbors are used right away, but are dropped
+ * unless we hear from them within NEIGHBORS_VERIFY_MS.
+ *
+ * @param owner Our ID
+ * @return The number of neighbors restored
+ */
+size_t lpmac_neighbors_restore(const lpmac_storage_t *storage, node_id_t owner) {
+    uint8_t buf[NEIGHBORS_SNAPSHOT_MAX];
+    struct neighbors_snapshot_hdr hdr;
+    uint16_t crc;
+    size_t size;
+    size_t restored = 0;
+    size_t index;
+
+    size = storage->read(storage, buf, sizeof(buf));
+    if (size < sizeof(hdr)) {
+        dprintf("No neighbor snapshot\n");
+        return 0;
+    }
+    memcpy(&hdr, buf, sizeof(hdr));
+    if (hdr.magic != NEIGHBORS_SNAPSHOT_MAGIC || hdr.version != NEIGHBORS_SNAPSHOT_VERSION
+            || hdr.count > NEIGHBORS_MAX || size < NEIGHBORS_SNAPSHOT_CALC_SIZE(hdr.count)
+            || hdr.owner != owner) {
+        dprintf("Ignoring invalid neighbor snapshot\n");
+        return 0;
+    }
+    size = NEIGHBORS_SNAPSHOT_CALC_SIZE(hdr.count);
+    crc = hdr.crc;
+    hdr.crc = 0;
+    memcpy(buf, &hdr, sizeof(hdr));
+    if (crc16(0xFFFF, buf, size) != crc) {
+        dprintf("Ignoring corrupt neighbor snapshot\n");
+        return 0;
+    }
+
+    for (index = 0; index < hdr.count; index++) {
+        struct neighbors_snapshot_entry saved;
+        bool added = false;
+        memcpy(&saved, buf + NEIGHBORS_SNAPSHOT_CALC_SIZE(index), sizeof(saved));
+        if (saved.id == NEIGHBOR_ID_BLANK || saved.id == owner
+                || saved.age_s > NEIGHBORS_RESTORE_AGE_MAX_S
+                || saved.etx < NEIGHBOR_ETX_ONE) {
+            continue;
+        }
+        table_entry_t entry = {
+                .id = saved.id,
+                .link_quality = saved.link_quality,
+                .etx = saved.etx,
+                .heard = Clock_getTicks(),
+                .verified = false
+        };
+        UInt key = write_begin();
+        if (table_find(saved.id) == NULL && table_add(&entry)) {
+            table_event(NEIGHBOR_EVENT_ADD, entry.id, entry.link_quality);
+            added = true;
+        }
+        write_end(key);
+        if (added) {
+            restored++;
+        }
+    }
+    if (restored > 0) {
+        events_pending();
+    }
+
+    dprintf("Restored %lu of %u neighbors\n", restored, hdr.count);
+    return restored;
+}
+
+/**
+ * Drop restored neighbors that we have not heard from since
+ */
+static void neighbors_expire() {
+    table_entry_t copy[NEIGHBORS_MAX];
+    uint32_t now = Clock_getTicks();
+    size_t index;
+
+    table_copy(copy);
+    for (index = 0; index < NEIGHBORS_MAX; index++) {
+        if (copy[index].id != NEIGHBOR_ID_BLANK && !copy[index].verified
+                && (now - copy[index].heard) > (NEIGHBORS_VERIFY_MS * TIME_MS)) {
+            UInt key = write_begin();
+            // Unless it was heard meanwhile
+            if (table[index].id == copy[index].id && !table[index].verified) {
+                table[index].id = NEIGHBOR_ID_BLANK;
+                table_event(NEIGHBOR_EVENT_REM, copy[index].id, 0);
+            }
+            write_end(key);
+            dprintf("Restored neighbor "PRINTF_FMT_NODE_ID" not heard, dropping\n", copy[index].id);
+        }
+    }
+}
+
+/**
+ * Deliver the queued neighbor events, in order, without holding any lock.
+ * The MAC task calls this whenever events are pending.
+ */
 void lpmac_neighbors_docallbacks() {
-	return;
+    pending_event_t event;
+    uint32_t lost;
+    bool more;
+
+    neighbors_expire();
+    do {
+        UInt key = Hwi_disable();
+        more = (pending_count > 0);
+        if (more) {
+            event = pending[pending_head];
+            pending_head = (pending_head + 1) % NEIGHBORS_EVENTS_MAX;
+            pending_count--;
+        }
+        lost = pending_lost;
+        pending_lost = 0;
+        Hwi_restore(key);
+
+        if (lost > 0) {
+            dprintf("Lost %lu neighbor events\n", lost);
+        }
+        if (more) {
+            neighbor_update_fn(event.type, event.id, event.link_quality);
+        }
+    } while (more);
 }
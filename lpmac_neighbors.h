@@ -7,16 +7,59 @@
 #ifndef LPMAC_LPMAC_NEIGHBORS_H_
 #define LPMAC_LPMAC_NEIGHBORS_H_
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "lpmac.h"
+#include "lpmac_storage.h"
 
 #define NEIGHBORS_MAX 12
 
-void lpmac_neighbors_init(neighbor_event_fn_t neighbor_updates_callback);
+/** ETX fixed point scale, a perfect link has an ETX of NEIGHBOR_ETX_ONE */
+#define NEIGHBOR_ETX_ONE 8
+
+/** Neighbor events that can wait for lpmac_neighbors_docallbacks */
+#define NEIGHBORS_EVENTS_MAX (2 * NEIGHBORS_MAX)
+
+#define NEIGHBORS_SNAPSHOT_MAGIC   0x4C504E42 // "LPNB"
+#define NEIGHBORS_SNAPSHOT_VERSION 1
+
+/**
+ * The stored neighbor table, a header followed by count entries
+ */
+struct neighbors_snapshot_hdr {
+    uint32_t  magic     : 32;
+    uint8_t   version   : 8;
+    uint8_t   count     : 8;
+    uint16_t  crc       : 16; // CRC-16/CCITT of the snapshot, computed with this field zero
+    node_id_t owner     : 32; // The node that saved it
+} __attribute__((__packed__));
+
+struct neighbors_snapshot_entry {
+    node_id_t id           : 32;
+    uint8_t   link_quality : 8;
+    uint16_t  etx          : 16;
+    uint32_t  age_s        : 32; // Time since it was last heard, when saved
+} __attribute__((__packed__));
+
+#define NEIGHBORS_SNAPSHOT_CALC_SIZE(count) (sizeof(struct neighbors_snapshot_hdr) + (sizeof(struct neighbors_snapshot_entry)*(count)))
+#define NEIGHBORS_SNAPSHOT_MAX NEIGHBORS_SNAPSHOT_CALC_SIZE(NEIGHBORS_MAX)
+
+void lpmac_neighbors_init(neighbor_event_fn_t neighbor_updates_callback,
+        void (*events_pending_callback)());
 void lpmac_neighbors_clear();
 void lpmac_neighbors_add(node_id_t node_id, link_quality_t link_quality);
 void lpmac_neighbors_rem(node_id_t node_id);
 void lpmac_neighbors_heard(node_id_t node_id, link_quality_t link_quality);
 void lpmac_neighbors_failed(node_id_t node_id);
+void lpmac_neighbors_acked(node_id_t node_id, unsigned attempts);
+uint16_t lpmac_neighbors_etx(node_id_t node_id);
+bool lpmac_neighbors_at(size_t index, node_id_t *node_id, uint16_t *etx);
+size_t lpmac_neighbors_snapshot(lpmac_neighbor_t *neighbors, size_t max);
+void lpmac_neighbors_show();
+bool lpmac_neighbors_save(const lpmac_storage_t *storage, node_id_t owner);
+size_t lpmac_neighbors_restore(const lpmac_storage_t *storage, node_id_t owner);
 void lpmac_neighbors_docallbacks();
 
 #endif /* LPMAC_LPMAC_NEIGHBORS_H_ */
@@ -0,0 +1,269 @@
+/**@file lpmac_routes.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/gates/GateMutexPri.h>
+
+#include "board.h"
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_routes_errors.h"
+#include "lpmac_neighbors.h"
+#include "lpmac_routes.h"
+
+#define ROUTE_DST_BLANK ((node_id_t)0x00000000)
+
+typedef struct route_entry {
+    node_id_t dst;
+    node_id_t next_hop;
+    uint16_t  metric;
+    uint32_t  updated; // Clock ticks
+} route_entry_t;
+static route_entry_t routes[ROUTES_MAX];
+
+typedef struct dup_entry {
+    node_id_t origin;
+    uint8_t   seq;
+} dup_entry_t;
+static dup_entry_t dups[ROUTE_DUPS_MAX];
+static size_t dups_next;
+
+static GateMutexPri_Struct routesMutexStruct;
+
+void lpmac_routes_init() {
+    GateMutexPri_construct(&routesMutexStruct, NULL);
+}
+
+static bool route_expired(route_entry_t *route) {
+    return (Clock_getTicks() - route->updated) > (ROUTES_TIMEOUT_MS * TIME_MS);
+}
+
+static route_entry_t *routes_find(node_id_t dst) {
+    size_t index;
+    for (index = 0; index < ROUTES_MAX; index++) {
+        if (routes[index].dst == dst) {
+            return &routes[index];
+        }
+    }
+    return NULL;
+}
+
+/**
+ * Find a slot for a new route. Prefers blank or expired slots,
+ * then the slot with the worst metric if it is worse than metric.
+ */
+static route_entry_t *routes_victim(uint16_t metric) {
+    size_t index;
+    route_entry_t *worst = NULL;
+    for (index = 0; index < ROUTES_MAX; index++) {
+        if (routes[index].dst == ROUTE_DST_BLANK || route_expired(&routes[index])) {
+            return &routes[index];
+        }
+        if (worst == NULL || routes[index].metric > worst->metric) {
+            worst = &routes[index];
+        }
+    }
+    if (worst != NULL && worst->metric > metric) {
+        return worst;
+    }
+    return NULL;
+}
+
+void lpmac_routes_clear() {
+    size_t index;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    for (index = 0; index < ROUTES_MAX; index++) {
+        routes[index].dst = ROUTE_DST_BLANK;
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+}
+
+/**
+ * Find the next hop toward dst.
+ *
+ * @return The next hop, which is dst itself for direct neighbors,
+ *         or 0 if there is no known route
+ */
+node_id_t lpmac_routes_lookup(node_id_t dst) {
+    node_id_t next_hop = ROUTE_DST_BLANK;
+    route_entry_t *route;
+
+    if (lpmac_neighbors_etx(dst) != 0) {
+        return dst;
+    }
+
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    route = routes_find(dst);
+    if (route != NULL) {
+        if (route_expired(route) || route->metric == ROUTE_METRIC_INFINITY) {
+            route->dst = ROUTE_DST_BLANK;
+        } else {
+            next_hop = route->next_hop;
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+    return next_hop;
+}
+
+/**
+ * Merge a neighbor's route advertisement into the route cache.
+ *
+ * @param from The neighbor that sent the advertisement
+ * @param link_etx The ETX of our link to from
+ * @param adv The advertisement, an array of struct route_adv
+ * @param adv_size The size of adv in bytes
+ */
+void lpmac_routes_update(node_id_t from, uint16_t link_etx, const uint8_t *adv, size_t adv_size) {
+    size_t count = adv_size / sizeof(struct route_adv);
+    node_id_t myid = LPMAC_MyId(0);
+    size_t index;
+
+    if (link_etx == 0) {
+        return;
+    }
+
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    for (index = 0; index < count; index++) {
+        struct route_adv entry;
+        route_entry_t *route;
+        uint32_t metric;
+
+        memcpy(&entry, adv + (index * sizeof(struct route_adv)), sizeof(entry));
+        if (entry.dst == myid || entry.dst == ROUTE_DST_BLANK) {
+            continue;
+        }
+
+        // A route from takes through us is no route for us (poison reverse)
+        metric = (uint32_t) entry.metric + link_etx;
+        if (entry.next_hop == myid || metric > ROUTE_METRIC_INFINITY) {
+            metric = ROUTE_METRIC_INFINITY;
+        }
+
+        route = routes_find(entry.dst);
+        if (route != NULL) {
+            // Always follow our current next hop, even if it got worse
+            if (route->next_hop != from && metric >= route->metric
+                    && !route_expired(route)) {
+                continue;
+            }
+        } else {
+            if (metric == ROUTE_METRIC_INFINITY) {
+                continue;
+            }
+            route = routes_victim((uint16_t) metric);
+            if (route == NULL) {
+                dprintf("Route Cache Full\n");
+                continue;
+            }
+        }
+        route->dst = entry.dst;
+        route->next_hop = from;
+        route->metric = (uint16_t) metric;
+        route->updated = Clock_getTicks();
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+}
+
+/**
+ * Build our route advertisement, which lists our direct neighbors
+ * followed by our cached routes, each with the neighbor it goes through.
+ *
+ * @return The number of bytes written to buf
+ */
+size_t lpmac_routes_advertisement(uint8_t *buf, size_t buf_size) {
+    size_t max = buf_size / sizeof(struct route_adv);
+    size_t count = 0;
+    size_t index;
+    struct route_adv entry;
+
+    for (index = 0; index < NEIGHBORS_MAX && count < max; index++) {
+        node_id_t id;
+        uint16_t etx;
+        if (lpmac_neighbors_at(index, &id, &etx)) {
+            entry.dst = id;
+            entry.next_hop = id;
+            entry.metric = etx;
+            memcpy(buf + (count++ * sizeof(entry)), &entry, sizeof(entry));
+        }
+    }
+
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    for (index = 0; index < ROUTES_MAX && count < max; index++) {
+        if (routes[index].dst != ROUTE_DST_BLANK && !route_expired(&routes[index])) {
+            entry.dst = routes[index].dst;
+            entry.next_hop = routes[index].next_hop;
+            entry.metric = routes[index].metric;
+            memcpy(buf + (count++ * sizeof(entry)), &entry, sizeof(entry));
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+
+    return count * sizeof(struct route_adv);
+}
+
+/**
+ * Drop every route that goes through a neighbor we lost
+ */
+void lpmac_routes_neighbor_lost(node_id_t node_id) {
+    size_t index;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    for (index = 0; index < ROUTES_MAX; index++) {
+        if (routes[index].next_hop == node_id) {
+            routes[index].dst = ROUTE_DST_BLANK;
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+}
+
+/**
+ * Check the duplicate cache for a mesh packet.
+ * Duplicates appear when a hop's ACK is lost and the previous hop resends.
+ *
+ * @return true if this origin/seq pair was already accepted
+ */
+bool lpmac_routes_seen(node_id_t origin, uint8_t seq) {
+    size_t index;
+    bool seen = false;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    for (index = 0; index < ROUTE_DUPS_MAX; index++) {
+        if (dups[index].origin == origin && dups[index].seq == seq) {
+            seen = true;
+            break;
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+    return seen;
+}
+
+/**
+ * Record an accepted mesh packet in the duplicate cache
+ */
+void lpmac_routes_remember(node_id_t origin, uint8_t seq) {
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    dups[dups_next].origin = origin;
+    dups[dups_next].seq = seq;
+    dups_next = (dups_next + 1) % ROUTE_DUPS_MAX;
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+}
+
+void lpmac_routes_show() {
+    size_t index;
+    size_t count = 0;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&routesMutexStruct));
+    for (index = 0; index < ROUTES_MAX; index++) {
+        if (routes[index].dst != ROUTE_DST_BLANK && !route_expired(&routes[index])) {
+            count++;
+            dprintf("Route %lu: 0x"PRINTF_FMT_NODE_ID" via 0x"PRINTF_FMT_NODE_ID" metric %u\n",
+                    count, routes[index].dst, routes[index].next_hop, routes[index].metric);
+        }
+    }
+    dprintf("Route List Complete - Total %lu\n", count);
+    GateMutexPri_leave(GateMutexPri_handle(&routesMutexStruct), key);
+}
@@ -0,0 +1,42 @@
+/**@file lpmac_routes.h
+ *
+ * Distance-vector routes over the neighbor table, using ETX as the metric.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_ROUTES_H_
+#define LPMAC_LPMAC_ROUTES_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+
+#define ROUTE_METRIC_INFINITY 0xFFFF
+#define ROUTE_DUPS_MAX        8
+
+/**
+ * One entry of a route advertisement, carried as the payload of JOIN packets.
+ * Advertisements are broadcast, so each entry names its next hop and that
+ * neighbor takes it as unreachable (split horizon with poison reverse).
+ */
+struct route_adv {
+    node_id_t dst      : 32;
+    node_id_t next_hop : 32;
+    uint16_t  metric   : 16;
+} __attribute__((__packed__));
+
+void lpmac_routes_init();
+void lpmac_routes_clear();
+node_id_t lpmac_routes_lookup(node_id_t dst);
+void lpmac_routes_update(node_id_t from, uint16_t link_etx, const uint8_t *adv, size_t adv_size);
+size_t lpmac_routes_advertisement(uint8_t *buf, size_t buf_size);
+void lpmac_routes_neighbor_lost(node_id_t node_id);
+bool lpmac_routes_seen(node_id_t origin, uint8_t seq);
+void lpmac_routes_remember(node_id_t origin, uint8_t seq);
+void lpmac_routes_show();
+
+#endif /* LPMAC_LPMAC_ROUTES_H_ */
@@ -0,0 +1,29 @@
+/**
+ * Define how errors are handled in LPMAC Routes
+ *
+ * @author Craig Hesling <craig@hesling.com>
+ * @date Oct 18, 2026
+ */
+
+#ifndef LPMAC_LPMAC_ROUTES_ERRORS_H_
+#define LPMAC_LPMAC_ROUTES_ERRORS_H_
+
+#include <stdio.h>
+#include <xdc/runtime/System.h>
+#include <io.h>
+
+/**@def dprintf
+ * Print formatted debugging messages
+ */
+#define dprintf(format, args...) printf("# LPMAC Routes: "##format, ##args); uartprintf("# LPMAC Routes: "##format, ##args)
+
+/**@def rerror
+ * Handle runtime error
+ */
+#define rerror(msg) uartputs(msg); System_abort(msg)
+
+
+// Could have pin toggle for debugging here
+//#include "io.h"
+
+#endif /* LPMAC_LPMAC_ROUTES_ERRORS_H_ */
@@ -0,0 +1,183 @@
+/**@file lpmac_rxq.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <xdc/std.h>
+#include <ti/sysbios/BIOS.h>
+#include <ti/sysbios/knl/Task.h>
+#include <ti/sysbios/knl/Semaphore.h>
+#include <ti/sysbios/gates/GateMutexPri.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_rxq.h"
+
+static rx_fn_t rx_fn;
+
+static uint8_t pool_data[RXQ_BUFFERS][RXQ_BUFFER_SIZE];
+static rxq_buf_t pool[RXQ_BUFFERS];
+static rxq_buf_t app_bufs[RXQ_APP_BUFFERS_MAX]; // Descriptors for posted buffers
+
+static rxq_buf_t *free_head;
+static rxq_buf_t *ready_head;
+static rxq_buf_t *ready_tail;
+
+static GateMutexPri_Struct rxqMutexStruct;
+static Semaphore_Struct readySemStruct;
+
+static Task_Params rxqTaskParams;
+static Task_Struct rxqTaskStruct;
+static Char rxqTaskStack[RXQ_TASK_STACKSIZE];
+
+/**
+ * Put a buffer back on the free list. Must be called with the queue locked.
+ */
+static void free_push(rxq_buf_t *buf) {
+    buf->next = free_head;
+    free_head = buf;
+}
+
+static rxq_buf_t *ready_pop() {
+    rxq_buf_t *buf;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&rxqMutexStruct));
+    buf = ready_head;
+    ready_head = buf->next;
+    if (ready_head == NULL) {
+        ready_tail = NULL;
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&rxqMutexStruct), key);
+    return buf;
+}
+
+static void rxqTask(UArg arg0, UArg arg1) {
+    while (1) {
+        rxq_buf_t *buf;
+        Semaphore_pend(Semaphore_handle(&readySemStruct), BIOS_WAIT_FOREVER);
+        buf = ready_pop();
+
+        if (buf->call != NULL) {
+            // Owned by whoever queued it
+            buf->call(buf);
+        } else if (buf->app) {
+            // The application owns it from here, and may post it again right away
+            uint8_t *data = buf->data;
+            size_t len = buf->len;
+            node_id_t src = buf->src;
+            link_quality_t link_quality = buf->link_quality;
+            UInt key = GateMutexPri_enter(GateMutexPri_handle(&rxqMutexStruct));
+            buf->used = false;
+            GateMutexPri_leave(GateMutexPri_handle(&rxqMutexStruct), key);
+            rx_fn(data, len, src, link_quality);
+        } else {
+            // Lent to the callback, ours again once it returns
+            rx_fn(buf->data, buf->len, buf->src, buf->link_quality);
+            UInt key = GateMutexPri_enter(GateMutexPri_handle(&rxqMutexStruct));
+            free_push(buf);
+            GateMutexPri_leave(GateMutexPri_handle(&rxqMutexStruct), key);
+        }
+    }
+}
+
+void lpmac_rxq_init(rx_fn_t rx_callback) {
+    size_t index;
+
+    rx_fn = rx_callback;
+    GateMutexPri_construct(&rxqMutexStruct, NULL);
+    Semaphore_construct(&readySemStruct, 0, NULL);
+
+    free_head = NULL;
+    ready_head = ready_tail = NULL;
+    for (index = 0; index < RXQ_BUFFERS; index++) {
+        pool[index].data = pool_data[index];
+        pool[index].size = RXQ_BUFFER_SIZE;
+        pool[index].app = false;
+        pool[index].call = NULL;
+        free_push(&pool[index]);
+    }
+    for (index = 0; index < RXQ_APP_BUFFERS_MAX; index++) {
+        app_bufs[index].app = true;
+        app_bufs[index].used = false;
+        app_bufs[index].call = NULL;
+    }
+
+    Task_Params_init(&rxqTaskParams);
+    rxqTaskParams.stackSize = RXQ_TASK_STACKSIZE;
+    rxqTaskParams.stack = &rxqTaskStack;
+    rxqTaskParams.priority = RXQ_TASK_PRIORITY;
+    Task_construct(&rxqTaskStruct, (Task_FuncPtr) rxqTask, &rxqTaskParams, NULL);
+}
+
+/**
+ * Take a free buffer that can hold len bytes.
+ *
+ * @return The buffer, or NULL if the application has fallen behind
+ */
+rxq_buf_t *lpmac_rxq_reserve(size_t len) {
+    rxq_buf_t **link;
+    rxq_buf_t *buf = NULL;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&rxqMutexStruct));
+    for (link = &free_head; *link != NULL; link = &(*link)->next) {
+        if ((*link)->size >= len) {
+            buf = *link;
+            *link = buf->next;
+            break;
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&rxqMutexStruct), key);
+    return buf;
+}
+
+/**
+ * Give back a reserved buffer that will not be delivered
+ */
+void lpmac_rxq_cancel(rxq_buf_t *buf) {
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&rxqMutexStruct));
+    free_push(buf);
+    GateMutexPri_leave(GateMutexPri_handle(&rxqMutexStruct), key);
+}
+
+/**
+ * Queue a filled buffer for the delivery task
+ */
+void lpmac_rxq_deliver(rxq_buf_t *buf) {
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&rxqMutexStruct));
+    buf->next = NULL;
+    if (ready_tail == NULL) {
+        ready_head = buf;
+    } else {
+        ready_tail->next = buf;
+    }
+    ready_tail = buf;
+    GateMutexPri_leave(GateMutexPri_handle(&rxqMutexStruct), key);
+    Semaphore_post(Semaphore_handle(&readySemStruct));
+}
+
+/**
+ * Give the MAC an application buffer to receive into.
+ * It is the application's again once passed to the rx callback.
+ *
+ * @return false if too many application buffers are outstanding
+ */
+bool lpmac_rxq_post(uint8_t *data, size_t size) {
+    size_t index;
+    bool posted = false;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&rxqMutexStruct));
+    for (index = 0; index < RXQ_APP_BUFFERS_MAX; index++) {
+        rxq_buf_t *buf = &app_bufs[index];
+        if (!buf->used) {
+            buf->used = true;
+            buf->data = data;
+            buf->size = size;
+            free_push(buf);
+            posted = true;
+            break;
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&rxqMutexStruct), key);
+    return posted;
+}
@@ -0,0 +1,43 @@
+/**@file lpmac_rxq.h
+ *
+ * The receive delivery queue. Received data is copied into a free buffer
+ * and handed to the application's rx callback from a separate delivery
+ * task, so a slow callback never holds up the MAC task.
+ *
+ * Buffers are either the MAC's own, lent to the callback and reused once
+ * it returns, or posted by the application with LPMAC_RxBufferPost, which
+ * belong to the application again once delivered. When no buffer is free
+ * the MAC answers with a busy ACK, so the sender backs off and retries.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_RXQ_H_
+#define LPMAC_LPMAC_RXQ_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+
+typedef struct rxq_buf {
+    struct rxq_buf *next;
+    uint8_t        *data;
+    size_t          size;  // Capacity of data
+    bool            app;   // Posted by the application, not returned to the pool
+    bool            used;  // An application descriptor holding a posted buffer
+    size_t          len;
+    node_id_t       src;
+    link_quality_t  link_quality;
+    void          (*call)(struct rxq_buf *buf); // Run instead of the rx callback, for the MAC's own deliveries
+} rxq_buf_t;
+
+void lpmac_rxq_init(rx_fn_t rx_callback);
+rxq_buf_t *lpmac_rxq_reserve(size_t len);
+void lpmac_rxq_cancel(rxq_buf_t *buf);
+void lpmac_rxq_deliver(rxq_buf_t *buf);
+bool lpmac_rxq_post(uint8_t *data, size_t size);
+
+#endif /* LPMAC_LPMAC_RXQ_H_ */
@@ -0,0 +1,189 @@
+/**@file lpmac_stats.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "board.h"
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_stats_errors.h"
+#include "lpmac_stats.h"
+
+#ifdef STATS_ENABLED
+
+#define STATS_ID_BLANK ((node_id_t)0x00000000)
+
+typedef struct stats_neighbor {
+    lpmac_neighbor_stats_t stats;
+    uint32_t               last; // Clock ticks of the last update
+} stats_neighbor_t;
+
+// Upper bounds of the time histogram buckets, the last bucket is unbounded
+static const uint32_t hist_bounds_ms[LPMAC_HIST_BUCKETS - 1] = {
+    50, 100, 200, 500, 1000, 2000, 5000
+};
+
+static lpmac_stats_t stats;
+static uint32_t reset_ticks;
+static stats_neighbor_t neighbors[STATS_NEIGHBORS_MAX];
+
+void lpmac_stats_init() {
+    lpmac_stats_reset();
+}
+
+void lpmac_stats_reset() {
+    UInt key = Hwi_disable();
+    memset(&stats, 0, sizeof(stats));
+    memset(neighbors, 0, sizeof(neighbors));
+    reset_ticks = Clock_getTicks();
+    Hwi_restore(key);
+}
+
+void lpmac_stats_add(lpmac_stat_t stat, uint32_t n) {
+    UInt key = Hwi_disable();
+    stats.counters[stat] += n;
+    Hwi_restore(key);
+}
+
+void lpmac_stats_sample(lpmac_hist_t hist, uint32_t value) {
+    size_t bucket;
+    if (hist == LPMAC_HIST_RETRIES) {
+        bucket = (value < LPMAC_HIST_BUCKETS) ? value : (LPMAC_HIST_BUCKETS - 1);
+    } else {
+        for (bucket = 0; bucket < (LPMAC_HIST_BUCKETS - 1); bucket++) {
+            if (value <= hist_bounds_ms[bucket]) {
+                break;
+            }
+        }
+    }
+    UInt key = Hwi_disable();
+    stats.hist[hist][bucket]++;
+    Hwi_restore(key);
+}
+
+/**
+ * Find the entry for a neighbor, taking over the least recently
+ * updated one if it has none. Must be called with interrupts disabled.
+ */
+static stats_neighbor_t *neighbors_find(node_id_t id) {
+    size_t index;
+    stats_neighbor_t *victim = &neighbors[0];
+    uint32_t now = Clock_getTicks();
+    for (index = 0; index < STATS_NEIGHBORS_MAX; index++) {
+        if (neighbors[index].stats.id == id) {
+            victim = &neighbors[index];
+            break;
+        }
+        if (neighbors[index].stats.id == STATS_ID_BLANK) {
+            if (victim->stats.id != STATS_ID_BLANK) {
+                victim = &neighbors[index];
+            }
+        } else if (victim->stats.id != STATS_ID_BLANK
+                && (now - neighbors[index].last) > (now - victim->last)) {
+            victim = &neighbors[index];
+        }
+    }
+    if (victim->stats.id != id) {
+        memset(victim, 0, sizeof(*victim));
+        victim->stats.id = id;
+    }
+    victim->last = now;
+    return victim;
+}
+
+void lpmac_stats_neighbor_add(node_id_t id, stats_neighbor_field_t field, uint32_t n) {
+    stats_neighbor_t *entry;
+    if (id == STATS_ID_BLANK) {
+        return;
+    }
+    UInt key = Hwi_disable();
+    entry = neighbors_find(id);
+    switch (field) {
+    case STATS_NEIGHBOR_TX_FRAMES:
+        entry->stats.tx_frames += n;
+        break;
+    case STATS_NEIGHBOR_TX_AIRTIME_MS:
+        entry->stats.tx_airtime_ms += n;
+        break;
+    case STATS_NEIGHBOR_ACKED:
+        entry->stats.acked += n;
+        break;
+    case STATS_NEIGHBOR_RETRIES:
+        entry->stats.retries += n;
+        break;
+    case STATS_NEIGHBOR_FAILURES:
+        entry->stats.failures += n;
+        break;
+    case STATS_NEIGHBOR_TX_ENERGY_UJ:
+        entry->stats.tx_energy_uj += n;
+        break;
+    }
+    Hwi_restore(key);
+}
+
+void lpmac_stats_neighbor_rx(node_id_t id, int16_t rssi) {
+    stats_neighbor_t *entry;
+    if (id == STATS_ID_BLANK) {
+        return;
+    }
+    UInt key = Hwi_disable();
+    entry = neighbors_find(id);
+    entry->stats.rx_frames++;
+    entry->stats.rssi = rssi;
+    Hwi_restore(key);
+}
+
+void lpmac_stats_get(lpmac_stats_t *copy) {
+    UInt key = Hwi_disable();
+    *copy = stats;
+    copy->uptime_ms = (Clock_getTicks() - reset_ticks) / TIME_MS;
+    Hwi_restore(key);
+}
+
+size_t lpmac_stats_neighbors_get(lpmac_neighbor_stats_t *copy, size_t max) {
+    size_t index;
+    size_t count = 0;
+    for (index = 0; index < STATS_NEIGHBORS_MAX && count < max; index++) {
+        UInt key = Hwi_disable();
+        if (neighbors[index].stats.id != STATS_ID_BLANK) {
+            copy[count++] = neighbors[index].stats;
+        }
+        Hwi_restore(key);
+    }
+    return count;
+}
+
+void lpmac_stats_show() {
+    lpmac_stats_t copy;
+    lpmac_stats_get(&copy);
+    dprintf("Stats over %lu ms\n", copy.uptime_ms);
+    dprintf("TX %lu frames, %lu bytes, %lu ms airtime, %lu timeouts, %lu CAD busy\n",
+            copy.counters[LPMAC_STAT_TX_FRAMES], copy.counters[LPMAC_STAT_TX_BYTES],
+            copy.counters[LPMAC_STAT_TX_AIRTIME_MS], copy.counters[LPMAC_STAT_TX_TIMEOUTS],
+            copy.counters[LPMAC_STAT_CAD_BUSY]);
+    dprintf("RX %lu frames, %lu bytes\n",
+            copy.counters[LPMAC_STAT_RX_FRAMES], copy.counters[LPMAC_STAT_RX_BYTES]);
+    dprintf("Send %lu ok, %lu failed, %lu retries, %lu ACKs in, %lu busy, %lu ACKs out, %lu forwarded\n",
+            copy.counters[LPMAC_STAT_SEND_OK], copy.counters[LPMAC_STAT_SEND_FAIL],
+            copy.counters[LPMAC_STAT_RETRIES], copy.counters[LPMAC_STAT_ACKS_RECEIVED],
+            copy.counters[LPMAC_STAT_ACKS_BUSY], copy.counters[LPMAC_STAT_ACKS_SENT],
+            copy.counters[LPMAC_STAT_FORWARDED]);
+    dprintf("Compressed %lu frames, %lu bytes saved\n",
+            copy.counters[LPMAC_STAT_TX_COMPRESSED], copy.counters[LPMAC_STAT_TX_BYTES_SAVED]);
+    dprintf("Drops: crc %lu, runt %lu, size %lu, filter %lu, dup %lu, no route %lu, queue %lu, rx full %lu, decompress %lu\n",
+            copy.counters[LPMAC_STAT_DROP_CRC], copy.counters[LPMAC_STAT_DROP_RUNT],
+            copy.counters[LPMAC_STAT_DROP_SIZE], copy.counters[LPMAC_STAT_DROP_FILTER],
+            copy.counters[LPMAC_STAT_DROP_DUPLICATE], copy.counters[LPMAC_STAT_DROP_NO_ROUTE],
+            copy.counters[LPMAC_STAT_DROP_QUEUE_FULL], copy.counters[LPMAC_STAT_DROP_RX_FULL],
+            copy.counters[LPMAC_STAT_DROP_DECOMPRESS]);
+}
+
+#endif
@@ -0,0 +1,51 @@
+/**@file lpmac_stats.h
+ *
+ * MAC counters and histograms. These are updated from the radio callbacks
+ * as well as the MAC task, so every update is a short interrupt-safe
+ * increment. Without STATS_ENABLED the updates compile away.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_STATS_H_
+#define LPMAC_LPMAC_STATS_H_
+
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+
+typedef enum {
+    STATS_NEIGHBOR_TX_FRAMES = 0,
+    STATS_NEIGHBOR_TX_AIRTIME_MS,
+    STATS_NEIGHBOR_ACKED,
+    STATS_NEIGHBOR_RETRIES,
+    STATS_NEIGHBOR_FAILURES,
+    STATS_NEIGHBOR_TX_ENERGY_UJ,
+} stats_neighbor_field_t;
+
+#ifdef STATS_ENABLED
+
+void lpmac_stats_init();
+void lpmac_stats_reset();
+void lpmac_stats_add(lpmac_stat_t stat, uint32_t n);
+void lpmac_stats_sample(lpmac_hist_t hist, uint32_t value);
+void lpmac_stats_neighbor_add(node_id_t id, stats_neighbor_field_t field, uint32_t n);
+void lpmac_stats_neighbor_rx(node_id_t id, int16_t rssi);
+void lpmac_stats_get(lpmac_stats_t *stats);
+size_t lpmac_stats_neighbors_get(lpmac_neighbor_stats_t *stats, size_t max);
+void lpmac_stats_show();
+
+#else
+
+static inline void lpmac_stats_init() {}
+static inline void lpmac_stats_reset() {}
+static inline void lpmac_stats_add(lpmac_stat_t stat, uint32_t n) {}
+static inline void lpmac_stats_sample(lpmac_hist_t hist, uint32_t value) {}
+static inline void lpmac_stats_neighbor_add(node_id_t id, stats_neighbor_field_t field, uint32_t n) {}
+static inline void lpmac_stats_neighbor_rx(node_id_t id, int16_t rssi) {}
+
+#endif
+
+#endif /* LPMAC_LPMAC_STATS_H_ */
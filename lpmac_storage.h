@@ -0,0 +1,37 @@
+/**@file lpmac_storage.h
+ *
+ * A small non-volatile storage interface, holding one blob.
+ * lpmac_storage_nvs keeps it in a TI Drivers NVS region on the target,
+ * lpmac_storage_file keeps it in a file for host builds.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_STORAGE_H_
+#define LPMAC_LPMAC_STORAGE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+typedef struct lpmac_storage {
+    /** Read up to size bytes of the blob, returning the number read, 0 on error */
+    size_t (*read)(const struct lpmac_storage *storage, void *buf, size_t size);
+    /** Replace the blob, returning false on error */
+    bool (*write)(const struct lpmac_storage *storage, const void *buf, size_t size);
+    void *ctx;
+} lpmac_storage_t;
+
+/**
+ * Use an NVS region, which must hold at least NEIGHBORS_SNAPSHOT_MAX bytes.
+ *
+ * @param nvs_handle An NVS_Handle from NVS_open
+ */
+void lpmac_storage_nvs(lpmac_storage_t *storage, void *nvs_handle);
+
+/**
+ * Use a file. The path must stay valid while the storage is used.
+ */
+void lpmac_storage_file(lpmac_storage_t *storage, const char *path);
+
+#endif /* LPMAC_LPMAC_STORAGE_H_ */
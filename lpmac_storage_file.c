@@ -0,0 +1,39 @@
+/**@file lpmac_storage_file.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdio.h>
+
+#include "lpmac_storage.h"
+
+static size_t file_read(const lpmac_storage_t *storage, void *buf, size_t size) {
+    FILE *file = fopen((const char *) storage->ctx, "rb");
+    size_t count;
+    if (file == NULL) {
+        return 0;
+    }
+    count = fread(buf, 1, size, file);
+    fclose(file);
+    return count;
+}
+
+static bool file_write(const lpmac_storage_t *storage, const void *buf, size_t size) {
+    FILE *file = fopen((const char *) storage->ctx, "wb");
+    bool ok;
+    if (file == NULL) {
+        return false;
+    }
+    ok = (fwrite(buf, 1, size, file) == size);
+    ok = (fclose(file) == 0) && ok;
+    return ok;
+}
+
+void lpmac_storage_file(lpmac_storage_t *storage, const char *path) {
+    storage->read = file_read;
+    storage->write = file_write;
+    storage->ctx = (void *) path;
+}
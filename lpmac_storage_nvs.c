@@ -0,0 +1,38 @@
+/**@file lpmac_storage_nvs.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ti/drivers/NVS.h>
+
+#include "lpmac_storage.h"
+
+static size_t nvs_read(const lpmac_storage_t *storage, void *buf, size_t size) {
+    NVS_Handle nvs = (NVS_Handle) storage->ctx;
+    NVS_Attrs attrs;
+
+    NVS_getAttrs(nvs, &attrs);
+    if (size > attrs.regionSize) {
+        size = attrs.regionSize;
+    }
+    if (NVS_read(nvs, 0, buf, size) != NVS_STATUS_SUCCESS) {
+        return 0;
+    }
+    return size;
+}
+
+static bool nvs_write(const lpmac_storage_t *storage, const void *buf, size_t size) {
+    NVS_Handle nvs = (NVS_Handle) storage->ctx;
+    return NVS_write(nvs, 0, (void *) buf, size,
+            NVS_WRITE_ERASE | NVS_WRITE_POST_VERIFY) == NVS_STATUS_SUCCESS;
+}
+
+void lpmac_storage_nvs(lpmac_storage_t *storage, void *nvs_handle) {
+    storage->read = nvs_read;
+    storage->write = nvs_write;
+    storage->ctx = nvs_handle;
+}
@@ -0,0 +1,229 @@
+/**@file lpmac_tdma.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/gates/GateMutexPri.h>
+
+#include "board.h"
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_tdma.h"
+
+#define SLOT_ID_BLANK ((node_id_t)0x00000000)
+
+static GateMutexPri_Struct tdmaMutexStruct;
+
+static bool coordinator;
+static bool synced;
+
+// Current schedule, built by the coordinator or learned from its beacons
+static uint16_t  beacon_seq;
+static uint8_t   slot_count;
+static node_id_t slots[TDMA_SLOTS_MAX];
+
+static uint32_t ref_ticks;  // Local ticks when the last beacon started on air
+static int32_t  drift_ppm;  // How much faster our clock runs than the coordinator's
+
+static int32_t to_local(int32_t coord_ms) {
+    return coord_ms + (int32_t) (((int64_t) coord_ms * drift_ppm) / 1000000);
+}
+
+static int32_t to_coord(int32_t local_ms) {
+    return local_ms - (int32_t) (((int64_t) local_ms * drift_ppm) / 1000000);
+}
+
+void lpmac_tdma_init() {
+    GateMutexPri_construct(&tdmaMutexStruct, NULL);
+}
+
+static void slots_assign(node_id_t node_id) {
+    size_t index;
+    for (index = 0; index < slot_count; index++) {
+        if (slots[index] == node_id) {
+            return;
+        }
+    }
+    if (slot_count < TDMA_SLOTS_MAX) {
+        slots[slot_count++] = node_id;
+    }
+}
+
+/**
+ * Become, or stop being, the coordinator of the cluster.
+ * The coordinator always owns the first slot.
+ */
+void lpmac_tdma_coordinator(bool enable, node_id_t myid) {
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&tdmaMutexStruct));
+    coordinator = enable;
+    synced = false;
+    slot_count = 0;
+    drift_ppm = 0;
+    if (enable) {
+        slots_assign(myid);
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+}
+
+bool lpmac_tdma_is_coordinator() {
+    bool is;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&tdmaMutexStruct));
+    is = coordinator;
+    GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+    return is;
+}
+
+/**
+ * As the coordinator, give node_id a slot if it does not have one
+ */
+void lpmac_tdma_assign(node_id_t node_id) {
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&tdmaMutexStruct));
+    if (coordinator) {
+        slots_assign(node_id);
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+}
+
+/**
+ * As the coordinator, build the beacon of the next superframe.
+ * The superframe starts when the beacon goes on air, see lpmac_tdma_beacon_sent.
+ *
+ * @return The number of bytes written to buf
+ */
+size_t lpmac_tdma_beacon(uint8_t *buf, size_t buf_size) {
+    struct tdma_beacon *beacon = (struct tdma_beacon *) buf;
+    size_t size = 0;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&tdmaMutexStruct));
+    if (buf_size >= TDMA_BEACON_CALC_SIZE(slot_count)) {
+        beacon->seq = ++beacon_seq;
+        beacon->slot_ms = TDMA_SLOT_MS;
+        beacon->slot_count = slot_count;
+        memcpy(beacon->slots, slots, sizeof(node_id_t) * slot_count);
+        size = TDMA_BEACON_CALC_SIZE(slot_count);
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+    return size;
+}
+
+/**
+ * As the coordinator, note that a beacon started on air.
+ * Members take the same instant as the start of the superframe.
+ */
+void lpmac_tdma_beacon_sent(uint32_t tx_ticks) {
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&tdmaMutexStruct));
+    if (coordinator) {
+        ref_ticks = tx_ticks;
+        synced = true;
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+}
+
+/**
+ * As a member, synchronize to a received beacon.
+ *
+ * @param buf The beacon payload
+ * @param size The size of the payload
+ * @param rx_ticks Local ticks when the beacon finished arriving
+ * @param airtime_ms The airtime of the beacon packet
+ */
+void lpmac_tdma_beacon_rx(const uint8_t *buf, size_t size, uint32_t rx_ticks, uint32_t airtime_ms) {
+    const struct tdma_beacon *beacon = (const struct tdma_beacon *) buf;
+    uint32_t start = rx_ticks - (airtime_ms * TIME_MS);
+    uint8_t count;
+    UInt key;
+
+    if (size < sizeof(struct tdma_beacon)) {
+        return;
+    }
+    count = beacon->slot_count;
+    if (count > TDMA_SLOTS_MAX || size < TDMA_BEACON_CALC_SIZE(count)
+            || beacon->slot_ms != TDMA_SLOT_MS) {
+        return;
+    }
+
+    key = GateMutexPri_enter(GateMutexPri_handle(&tdmaMutexStruct));
+    if (coordinator) {
+        GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+        return;
+    }
+    if (synced) {
+        // Compare the superframes we measured with what the coordinator sent.
+        // Anything beyond a crystal's tolerance is a late or mistimed beacon.
+        uint16_t frames = (uint16_t) (beacon->seq - beacon_seq);
+        int64_t expected = (int64_t) TDMA_SUPERFRAME_MS(slot_count) * frames * TIME_MS;
+        int64_t measured = (int64_t) (uint32_t) (start - ref_ticks);
+        if (frames > 0 && frames <= TDMA_SYNC_LOST_BEACONS && expected > 0) {
+            int32_t sample = (int32_t) (((measured - expected) * 1000000) / expected);
+            if (sample >= -TDMA_DRIFT_PPM_MAX && sample <= TDMA_DRIFT_PPM_MAX) {
+                drift_ppm += (sample - drift_ppm) / 4;
+            }
+        }
+    }
+
+    beacon_seq = beacon->seq;
+    slot_count = count;
+    memcpy(slots, beacon->slots, sizeof(node_id_t) * count);
+    ref_ticks = start;
+    synced = true;
+    GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+}
+
+/**
+ * Find when we may transmit an exchange that needs airtime_ms.
+ * Nodes with a slot use it, all others use the contention slot.
+ *
+ * @param myid Our node ID
+ * @param airtime_ms The airtime of the packet and its ACK
+ * @param[out] delay_ms The time to wait before transmitting
+ * @return true if we are synchronized, false if the schedule is unknown
+ */
+bool lpmac_tdma_wait(node_id_t myid, uint32_t airtime_ms, uint32_t *delay_ms) {
+    uint32_t superframe;
+    uint32_t slot = TDMA_SLOT_CONTENTION;
+    uint32_t elapsed, pos, start, end;
+    size_t index;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&tdmaMutexStruct));
+
+    superframe = TDMA_SUPERFRAME_MS(slot_count);
+    if (!synced) {
+        GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+        return false;
+    }
+
+    elapsed = (uint32_t) to_coord((int32_t) ((Clock_getTicks() - ref_ticks) / TIME_MS));
+    if (!coordinator && elapsed > (superframe * TDMA_SYNC_LOST_BEACONS)) {
+        synced = false;
+        GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+        return false;
+    }
+
+    for (index = 0; index < slot_count; index++) {
+        if (slots[index] == myid) {
+            slot = TDMA_SLOT_FIRST + index;
+            break;
+        }
+    }
+
+    pos = elapsed % superframe;
+    start = (slot * TDMA_SLOT_MS) + TDMA_GUARD_MS;
+    end = ((slot + 1) * TDMA_SLOT_MS) - TDMA_GUARD_MS;
+    if (slot == TDMA_SLOT_CONTENTION) {
+        // Spread contending nodes over the slot, CAD sorts out the rest
+        start += rand() % (TDMA_SLOT_MS / 2);
+    }
+
+    if (pos >= start && (pos + airtime_ms) <= end) {
+        *delay_ms = 0;
+    } else {
+        *delay_ms = (uint32_t) to_local((int32_t) ((start + superframe - pos) % superframe));
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&tdmaMutexStruct), key);
+    return true;
+}
@@ -0,0 +1,48 @@
+/**@file lpmac_tdma.h
+ *
+ * Beacon synchronized TDMA. A coordinator broadcasts a beacon at the start
+ * of every superframe, carrying the slot assignments. Slot 0 holds the
+ * beacon, slot 1 is a contention slot for nodes without a slot, and the
+ * rest are owned by one node each.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_TDMA_H_
+#define LPMAC_LPMAC_TDMA_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+
+#define TDMA_SLOT_BEACON     0
+#define TDMA_SLOT_CONTENTION 1
+#define TDMA_SLOT_FIRST      2
+
+/**
+ * The payload of beacon packets
+ */
+struct tdma_beacon {
+    uint16_t  seq        : 16;
+    uint16_t  slot_ms    : 16;
+    uint8_t   slot_count : 8; // Number of owned slots that follow the contention slot
+    node_id_t slots[];
+} __attribute__((__packed__));
+
+#define TDMA_BEACON_CALC_SIZE(slot_count) (sizeof(struct tdma_beacon) + (sizeof(node_id_t)*(slot_count)))
+#define TDMA_SUPERFRAME_MS(slot_count) ((uint32_t)(TDMA_SLOT_FIRST + (slot_count)) * TDMA_SLOT_MS)
+
+void lpmac_tdma_init();
+void lpmac_tdma_coordinator(bool enable, node_id_t myid);
+bool lpmac_tdma_is_coordinator();
+void lpmac_tdma_assign(node_id_t node_id);
+size_t lpmac_tdma_beacon(uint8_t *buf, size_t buf_size);
+void lpmac_tdma_beacon_sent(uint32_t tx_ticks);
+void lpmac_tdma_beacon_rx(const uint8_t *buf, size_t size, uint32_t rx_ticks, uint32_t airtime_ms);
+bool lpmac_tdma_wait(node_id_t myid, uint32_t airtime_ms, uint32_t *delay_ms);
+
+#endif /* LPMAC_LPMAC_TDMA_H_ */
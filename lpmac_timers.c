@@ -0,0 +1,279 @@
+/**@file lpmac_timers.c
+ *
+ * The wheel has TIMERS_LEVELS levels of 32 slots. Level 0 slots are one
+ * wheel tick apart, and each higher level's slots span a whole rotation of
+ * the level below. A timer goes into the level that covers its distance,
+ * and moves down a level when the level below comes around to it.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <xdc/std.h>
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "board.h"
+
+#include "lpmac_config.h"
+#include "lpmac_timers.h"
+
+#define WHEEL_BITS  5
+#define WHEEL_SLOTS (1 << WHEEL_BITS) // One bit each in a level's bitmap
+#define WHEEL_MASK  (WHEEL_SLOTS - 1)
+#define WHEEL_SPAN(level) (1UL << (WHEEL_BITS * (level)))
+#define WHEEL_RANGE WHEEL_SPAN(TIMERS_LEVELS) // Farthest distance the wheel covers
+#define WHEEL_INDEX(tick, level) (((tick) >> (WHEEL_BITS * (level))) & WHEEL_MASK)
+
+#define CLOCK_PER_TICK (TIMERS_TICK_MS * TIME_MS)
+
+static lpmac_timer_t *wheel[TIMERS_LEVELS * WHEEL_SLOTS];
+static uint32_t occupied[TIMERS_LEVELS]; // Bitmap of non empty slots per level
+static uint32_t wheel_now;  // The next tick to process
+static uint32_t real_now;   // The current tick
+static uint32_t clock_base; // Clock ticks at real_now
+static uint32_t pending;    // Timers in the wheel
+
+static Clock_Struct wheelClockStruct;
+
+/*
+ * Everything below that touches the wheel runs with interrupts disabled
+ */
+
+static uint32_t wheel_real() {
+    uint32_t ticks = (Clock_getTicks() - clock_base) / CLOCK_PER_TICK;
+    clock_base += ticks * CLOCK_PER_TICK;
+    real_now += ticks;
+    return real_now;
+}
+
+static void wheel_add(lpmac_timer_t *timer) {
+    uint32_t distance = timer->expires - wheel_now;
+    size_t level;
+    uint8_t slot;
+
+    if ((int32_t) distance < 0) {
+        // Already due, take it on the next tick processed
+        distance = 0;
+        timer->expires = wheel_now;
+    }
+    for (level = 0; level < (TIMERS_LEVELS - 1); level++) {
+        if (distance < WHEEL_SPAN(level + 1)) {
+            break;
+        }
+    }
+    if (distance >= WHEEL_RANGE) {
+        // Parked in the farthest slot, and filed again when it comes down
+        slot = (uint8_t) ((level * WHEEL_SLOTS)
+                + WHEEL_INDEX(wheel_now + WHEEL_RANGE - 1, level));
+    } else {
+        slot = (uint8_t) ((level * WHEEL_SLOTS) + WHEEL_INDEX(timer->expires, level));
+    }
+
+    timer->slot = slot;
+    timer->prev = NULL;
+    timer->next = wheel[slot];
+    if (timer->next != NULL) {
+        timer->next->prev = timer;
+    }
+    wheel[slot] = timer;
+    occupied[level] |= 1UL << (slot & WHEEL_MASK);
+    timer->active = true;
+    pending++;
+}
+
+static void wheel_remove(lpmac_timer_t *timer) {
+    if (timer->prev != NULL) {
+        timer->prev->next = timer->next;
+    } else {
+        wheel[timer->slot] = timer->next;
+        if (timer->next == NULL) {
+            occupied[timer->slot / WHEEL_SLOTS] &= ~(1UL << (timer->slot & WHEEL_MASK));
+        }
+    }
+    if (timer->next != NULL) {
+        timer->next->prev = timer->prev;
+    }
+    timer->active = false;
+    pending--;
+}
+
+/**
+ * @return The number of slots from index to the next occupied one, or WHEEL_SLOTS
+ */
+static uint32_t bitmap_distance(uint32_t bitmap, uint32_t index) {
+    uint32_t distance;
+    for (distance = 0; distance < WHEEL_SLOTS; distance++) {
+        if (bitmap & (1UL << ((index + distance) & WHEEL_MASK))) {
+            return distance;
+        }
+    }
+    return WHEEL_SLOTS;
+}
+
+/**
+ * Find the first tick at or after from where something happens, either
+ * a level 0 slot expiring or a higher level slot moving down.
+ *
+ * @return false if the wheel is empty
+ */
+static bool wheel_next(uint32_t from, uint32_t *next) {
+    uint32_t best = WHEEL_RANGE;
+    uint32_t distance;
+    size_t level;
+
+    if (pending == 0) {
+        return false;
+    }
+    distance = bitmap_distance(occupied[0], WHEEL_INDEX(from, 0));
+    if (distance < WHEEL_SLOTS) {
+        best = distance;
+    }
+    for (level = 1; level < TIMERS_LEVELS; level++) {
+        // Slots move down at ticks that are a multiple of the level's span
+        uint32_t span = WHEEL_SPAN(level);
+        uint32_t boundary = (from + span - 1) & ~(span - 1);
+        distance = bitmap_distance(occupied[level], WHEEL_INDEX(boundary, level));
+        if (distance < WHEEL_SLOTS) {
+            distance = (boundary - from) + (distance * span);
+            if (distance < best) {
+                best = distance;
+            }
+        }
+    }
+    *next = from + best;
+    return true;
+}
+
+/**
+ * Refile every timer in a higher level slot into the levels below
+ */
+static void wheel_cascade(size_t level, uint32_t index) {
+    lpmac_timer_t *timer = wheel[(level * WHEEL_SLOTS) + index];
+    while (timer != NULL) {
+        lpmac_timer_t *next = timer->next;
+        wheel_remove(timer);
+        wheel_add(timer);
+        timer = next;
+    }
+}
+
+/**
+ * Arm the Clock for the next tick where something happens
+ */
+static void wheel_arm() {
+    uint32_t next;
+    Clock_stop(Clock_handle(&wheelClockStruct));
+    if (wheel_next(wheel_now, &next)) {
+        uint32_t now = wheel_real();
+        uint32_t ticks = ((int32_t) (next - now) > 0) ? (next - now) : 1;
+        // Less the part of the current tick that already passed, which is under a tick
+        uint32_t timeout = (ticks * CLOCK_PER_TICK) - (Clock_getTicks() - clock_base);
+        Clock_setTimeout(Clock_handle(&wheelClockStruct), timeout);
+        Clock_start(Clock_handle(&wheelClockStruct));
+    }
+}
+
+static Void wheel_callback(UArg arg) {
+    uint32_t next;
+
+    UInt key = Hwi_disable();
+    while (wheel_next(wheel_now, &next) && (int32_t) (next - wheel_real()) <= 0) {
+        size_t level;
+        lpmac_timer_t *timer;
+
+        wheel_now = next;
+        for (level = 1; level < TIMERS_LEVELS; level++) {
+            if (WHEEL_INDEX(wheel_now, level - 1) != 0) {
+                break;
+            }
+            wheel_cascade(level, WHEEL_INDEX(wheel_now, level));
+        }
+
+        while ((timer = wheel[WHEEL_INDEX(wheel_now, 0)]) != NULL) {
+            wheel_remove(timer);
+            if ((int32_t) (timer->expires - wheel_now) > 0) {
+                // Cascaded down early, not due yet
+                wheel_add(timer);
+                continue;
+            }
+            if (timer->period > 0) {
+                // Periods missed while we were late are dropped
+                timer->expires += timer->period;
+                if ((int32_t) (timer->expires - real_now) <= 0) {
+                    timer->expires = real_now + timer->period;
+                }
+                wheel_add(timer);
+            }
+            // The function may start or stop any timer, including this one
+            Hwi_restore(key);
+            timer->fn(timer->arg);
+            key = Hwi_disable();
+        }
+        wheel_now++;
+    }
+    wheel_now = real_now + 1;
+    wheel_arm();
+    Hwi_restore(key);
+}
+
+void lpmac_timers_init() {
+    Clock_Params params;
+    Clock_Params_init(&params);
+    params.period = 0;
+    params.startFlag = FALSE;
+    Clock_construct(&wheelClockStruct, wheel_callback, 0, &params);
+    clock_base = Clock_getTicks();
+    wheel_now = real_now = 0;
+}
+
+void lpmac_timer_init(lpmac_timer_t *timer, lpmac_timer_fn_t fn, UArg arg) {
+    timer->active = false;
+    timer->fn = fn;
+    timer->arg = arg;
+}
+
+/**
+ * Start or restart a timer.
+ *
+ * @param ms Time until it expires, rounded up to the next wheel tick
+ * @param period_ms Time between expiries after the first, or 0 for a one shot timer
+ */
+void lpmac_timer_start(lpmac_timer_t *timer, uint32_t ms, uint32_t period_ms) {
+    UInt key = Hwi_disable();
+    if (timer->active) {
+        wheel_remove(timer);
+    }
+    if (pending == 0) {
+        // Nothing to process in between, so skip ahead
+        wheel_now = wheel_real();
+    }
+    timer->expires = wheel_real() + ((ms + TIMERS_TICK_MS - 1) / TIMERS_TICK_MS);
+    if (Clock_getTicks() != clock_base || ms == 0) {
+        // Count the part of the current tick that already passed as a whole tick
+        timer->expires++;
+    }
+    timer->period = (period_ms + TIMERS_TICK_MS - 1) / TIMERS_TICK_MS;
+    wheel_add(timer);
+    wheel_arm();
+    Hwi_restore(key);
+}
+
+/**
+ * Stop a timer. Stopping one that is not running does nothing.
+ */
+void lpmac_timer_stop(lpmac_timer_t *timer) {
+    UInt key = Hwi_disable();
+    if (timer->active) {
+        wheel_remove(timer);
+    }
+    timer->period = 0;
+    Hwi_restore(key);
+}
+
+bool lpmac_timer_active(const lpmac_timer_t *timer) {
+    return timer->active;
+}
@@ -0,0 +1,43 @@
+/**@file lpmac_timers.h
+ *
+ * A hierarchical timer wheel driven by a single Clock. Timers are owned by
+ * the caller, so there is no limit on how many run at once, and starting or
+ * stopping one takes constant time. The Clock is only armed for the next
+ * slot that holds a timer, so timers that expire close together share one
+ * wakeup and an idle wheel does not wake up at all.
+ *
+ * Expiry functions run in the Clock's Swi, like Clock functions, so they
+ * must not block. Timers may be started and stopped from tasks and Swis.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_TIMERS_H_
+#define LPMAC_LPMAC_TIMERS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <xdc/std.h>
+
+typedef Void (*lpmac_timer_fn_t)(UArg arg);
+
+typedef struct lpmac_timer {
+    struct lpmac_timer *next;
+    struct lpmac_timer *prev;
+    uint32_t            expires; // In wheel ticks
+    uint32_t            period;  // In wheel ticks, 0 for one shot
+    uint8_t             slot;    // Index of the wheel list holding it
+    bool                active;
+    lpmac_timer_fn_t    fn;
+    UArg                arg;
+} lpmac_timer_t;
+
+void lpmac_timers_init();
+void lpmac_timer_init(lpmac_timer_t *timer, lpmac_timer_fn_t fn, UArg arg);
+void lpmac_timer_start(lpmac_timer_t *timer, uint32_t ms, uint32_t period_ms);
+void lpmac_timer_stop(lpmac_timer_t *timer);
+bool lpmac_timer_active(const lpmac_timer_t *timer);
+
+#endif /* LPMAC_LPMAC_TIMERS_H_ */
@@ -0,0 +1,143 @@
+/**@file lpmac_trace.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <string.h>
+
+#include <ti/sysbios/knl/Clock.h>
+#include <ti/sysbios/hal/Hwi.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_trace_errors.h"
+#include "lpmac_trace.h"
+
+#ifdef TRACE_ENABLED
+
+/**
+ * A record in the ring, followed by len captured frame bytes
+ */
+typedef struct trace_record {
+    uint32_t ticks;
+    uint8_t  event;
+    uint8_t  len;  // Captured bytes that follow
+    uint16_t size; // Size of the frame, for TX and RX
+    int16_t  arg0;
+    int16_t  arg1;
+} __attribute__((__packed__)) trace_record_t;
+
+static uint8_t ring[TRACE_BUFFER_SIZE];
+static size_t ring_head; // Where the next record is written
+static size_t ring_tail; // The oldest record
+static size_t ring_used;
+static uint32_t dropped; // Records overwritten since the last dump
+
+void lpmac_trace_init() {
+    ring_head = ring_tail = ring_used = 0;
+    dropped = 0;
+}
+
+static void ring_write(const void *data, size_t size) {
+    const uint8_t *bytes = (const uint8_t *) data;
+    while (size-- > 0) {
+        ring[ring_head] = *bytes++;
+        ring_head = (ring_head + 1) % TRACE_BUFFER_SIZE;
+    }
+}
+
+static void ring_read(void *data, size_t size) {
+    uint8_t *bytes = (uint8_t *) data;
+    while (size-- > 0) {
+        *bytes++ = ring[ring_tail];
+        ring_tail = (ring_tail + 1) % TRACE_BUFFER_SIZE;
+    }
+}
+
+/**
+ * Remove the oldest record. Must be called with interrupts disabled.
+ *
+ * @param frame Where to copy the captured bytes, or NULL to discard them
+ */
+static void ring_pop(trace_record_t *record, uint8_t *frame) {
+    ring_read(record, sizeof(*record));
+    if (frame != NULL) {
+        ring_read(frame, record->len);
+    } else {
+        ring_tail = (ring_tail + record->len) % TRACE_BUFFER_SIZE;
+    }
+    ring_used -= sizeof(*record) + record->len;
+}
+
+void lpmac_trace_frame(trace_event_t event, const uint8_t *frame, size_t size,
+                       int16_t arg0, int16_t arg1) {
+    trace_record_t record;
+    size_t needed;
+
+    record.ticks = Clock_getTicks();
+    record.event = (uint8_t) event;
+    record.len = (uint8_t) ((size < TRACE_CAPTURE_MAX) ? size : TRACE_CAPTURE_MAX);
+    record.size = (uint16_t) size;
+    record.arg0 = arg0;
+    record.arg1 = arg1;
+    needed = sizeof(record) + record.len;
+
+    UInt key = Hwi_disable();
+    while ((TRACE_BUFFER_SIZE - ring_used) < needed) {
+        trace_record_t old;
+        ring_pop(&old, NULL);
+        dropped++;
+    }
+    ring_write(&record, sizeof(record));
+    ring_write(frame, record.len);
+    ring_used += needed;
+    Hwi_restore(key);
+}
+
+void lpmac_trace(trace_event_t event, int16_t arg0, int16_t arg1) {
+    lpmac_trace_frame(event, NULL, 0, arg0, arg1);
+}
+
+/**
+ * Print and remove every record, oldest first.
+ * Each line is "TRACE <ticks> <event> <size> <arg0> <arg1> <hex frame bytes>".
+ */
+void lpmac_trace_dump() {
+    static const char hexdigits[] = "0123456789abcdef";
+    trace_record_t record;
+    uint8_t frame[TRACE_CAPTURE_MAX];
+    char hex[(2 * TRACE_CAPTURE_MAX) + 1];
+    uint32_t lost;
+    bool more;
+    size_t index;
+
+    dprintf("TRACE BEGIN %u %lu\n", TRACE_FORMAT_VERSION, (uint32_t) Clock_tickPeriod);
+    do {
+        UInt key = Hwi_disable();
+        more = (ring_used > 0);
+        if (more) {
+            ring_pop(&record, frame);
+        }
+        Hwi_restore(key);
+
+        if (more) {
+            for (index = 0; index < record.len; index++) {
+                hex[(2 * index)] = hexdigits[frame[index] >> 4];
+                hex[(2 * index) + 1] = hexdigits[frame[index] & 0xF];
+            }
+            hex[2 * record.len] = '\0';
+            dprintf("TRACE %lu %u %u %d %d %s\n", record.ticks, record.event,
+                    record.size, record.arg0, record.arg1, hex);
+        }
+    } while (more);
+
+    UInt key = Hwi_disable();
+    lost = dropped;
+    dropped = 0;
+    Hwi_restore(key);
+    dprintf("TRACE END %lu\n", lost);
+}
+
+#endif
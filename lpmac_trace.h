@@ -0,0 +1,66 @@
+/**@file lpmac_trace.h
+ *
+ * A timestamped trace of MAC and radio events, kept in a ring buffer that
+ * overwrites the oldest records. TX and RX records carry the start of the
+ * frame. LPMAC_TraceDump prints the records for tools/lpmac_trace.py,
+ * which turns them into a pcap or a Chrome trace.
+ * Without TRACE_ENABLED the records compile away.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_TRACE_H_
+#define LPMAC_LPMAC_TRACE_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+
+#define TRACE_FORMAT_VERSION 1
+
+/**
+ * Trace events. The values are part of the dump format, so only append.
+ */
+typedef enum {
+    TRACE_STATE       = 0,  // arg0 = trace_state_t the radio was put in
+    TRACE_BACKOFF     = 1,  // arg0 = delay in ms
+    TRACE_CAD_START   = 2,
+    TRACE_CAD_DONE    = 3,  // arg0 = 1 if activity was detected
+    TRACE_TX_START    = 4,  // size = frame size, frame captured
+    TRACE_TX_DONE     = 5,  // arg0 = 1 if the radio timed out
+    TRACE_RX          = 6,  // size = frame size, arg0 = RSSI, arg1 = SNR, frame captured
+    TRACE_RX_DROP     = 7,  // arg0 = the lpmac_stat_t drop reason
+    TRACE_RX_TIMEOUT  = 8,
+    TRACE_SEND_START  = 9,  // arg0 = pkt_id, arg1 = priority
+    TRACE_SEND_DONE   = 10, // arg0 = pkt_id, arg1 = 1 if acknowledged
+    TRACE_ACK         = 11, // arg0 = pkt_id, arg1 = attempts
+    TRACE_TIMEOUT     = 12, // arg0 = pkt_id, arg1 = retries so far
+} trace_event_t;
+
+typedef enum {
+    TRACE_STATE_SLEEP   = 0,
+    TRACE_STATE_STANDBY = 1,
+    TRACE_STATE_RX      = 2,
+} trace_state_t;
+
+#ifdef TRACE_ENABLED
+
+void lpmac_trace_init();
+void lpmac_trace(trace_event_t event, int16_t arg0, int16_t arg1);
+void lpmac_trace_frame(trace_event_t event, const uint8_t *frame, size_t size,
+                       int16_t arg0, int16_t arg1);
+void lpmac_trace_dump();
+
+#else
+
+static inline void lpmac_trace_init() {}
+static inline void lpmac_trace(trace_event_t event, int16_t arg0, int16_t arg1) {}
+static inline void lpmac_trace_frame(trace_event_t event, const uint8_t *frame, size_t size,
+                                     int16_t arg0, int16_t arg1) {}
+
+#endif
+
+#endif /* LPMAC_LPMAC_TRACE_H_ */
@@ -0,0 +1,141 @@
+/**@file lpmac_txq.c
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ti/sysbios/gates/GateMutexPri.h>
+
+#include "lpmac.h"
+#include "lpmac_config.h"
+#include "lpmac_types.h"
+#include "lpmac_txq.h"
+
+/**
+ * The packets queued for one destination in one class
+ */
+typedef struct txq_flow {
+    node_id_t    dst;
+    bool         active;
+    int32_t      deficit; // Bytes this flow may still send in this round
+    txq_entry_t *head;
+    txq_entry_t *tail;
+} txq_flow_t;
+
+typedef struct txq_class {
+    txq_flow_t flows[TXQ_FLOWS_MAX];
+    size_t     active;  // Number of active flows
+    size_t     current; // The flow being visited
+    bool       granted; // The current flow got its quantum for this visit
+} txq_class_t;
+
+static txq_class_t classes[LPMAC_PRIORITY_COUNT];
+static GateMutexPri_Struct txqMutexStruct;
+
+void lpmac_txq_init() {
+    GateMutexPri_construct(&txqMutexStruct, NULL);
+}
+
+static node_id_t entry_dst(txq_entry_t *entry) {
+    return (entry->hdr->dst_count > 0) ? entry->hdr->dst[0] : 0;
+}
+
+static txq_flow_t *class_flow(txq_class_t *txclass, node_id_t dst) {
+    size_t index;
+    txq_flow_t *blank = NULL;
+    for (index = 0; index < TXQ_FLOWS_MAX; index++) {
+        txq_flow_t *flow = &txclass->flows[index];
+        if (flow->active && flow->dst == dst) {
+            return flow;
+        }
+        if (!flow->active && blank == NULL) {
+            blank = flow;
+        }
+    }
+    if (blank != NULL) {
+        blank->dst = dst;
+        blank->active = true;
+        blank->deficit = 0;
+        blank->head = blank->tail = NULL;
+        txclass->active++;
+    }
+    return blank;
+}
+
+static void class_advance(txq_class_t *txclass) {
+    txclass->current = (txclass->current + 1) % TXQ_FLOWS_MAX;
+    txclass->granted = false;
+}
+
+/**
+ * Queue a packet behind the others for the same destination and class.
+ *
+ * @return true if queued, false if the class has no room for another destination
+ */
+bool lpmac_txq_push(txq_entry_t *entry) {
+    txq_flow_t *flow;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&txqMutexStruct));
+    flow = class_flow(&classes[entry->priority], entry_dst(entry));
+    if (flow != NULL) {
+        entry->next = NULL;
+        if (flow->tail != NULL) {
+            flow->tail->next = entry;
+        } else {
+            flow->head = entry;
+        }
+        flow->tail = entry;
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&txqMutexStruct), key);
+    return flow != NULL;
+}
+
+/**
+ * Take the next packet to send.
+ * The highest priority class with packets wins. Within it, each destination
+ * gets TXQ_QUANTUM bytes per round, so a destination with many large packets
+ * cannot starve the others.
+ *
+ * @return The next packet, or NULL if the queue is empty
+ */
+txq_entry_t *lpmac_txq_pop() {
+    txq_entry_t *entry = NULL;
+    size_t priority;
+    UInt key = GateMutexPri_enter(GateMutexPri_handle(&txqMutexStruct));
+    for (priority = 0; priority < LPMAC_PRIORITY_COUNT && entry == NULL; priority++) {
+        txq_class_t *txclass = &classes[priority];
+        while (txclass->active > 0) {
+            txq_flow_t *flow = &txclass->flows[txclass->current];
+            size_t size;
+            if (!flow->active) {
+                class_advance(txclass);
+                continue;
+            }
+            if (!txclass->granted) {
+                flow->deficit += TXQ_QUANTUM;
+                txclass->granted = true;
+            }
+            size = PKT_SIZE(flow->head->hdr);
+            if ((int32_t) size > flow->deficit) {
+                class_advance(txclass);
+                continue;
+            }
+
+            entry = flow->head;
+            flow->deficit -= size;
+            flow->head = entry->next;
+            if (flow->head == NULL) {
+                flow->tail = NULL;
+                flow->active = false;
+                flow->deficit = 0;
+                txclass->active--;
+                class_advance(txclass);
+            }
+            break;
+        }
+    }
+    GateMutexPri_leave(GateMutexPri_handle(&txqMutexStruct), key);
+    return entry;
+}
@@ -0,0 +1,40 @@
+/**@file lpmac_txq.h
+ *
+ * The transmit queue. Priority classes are served in strict priority order,
+ * and destinations within a class share it by deficit round robin.
+ *
+ * @date Oct 18, 2026
+ * @author Craig Hesling <craig@hesling.com>
+ */
+
+#ifndef LPMAC_LPMAC_TXQ_H_
+#define LPMAC_LPMAC_TXQ_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <ti/sysbios/knl/Semaphore.h>
+
+#include "lpmac.h"
+#include "lpmac_types.h"
+
+/**
+ * A queued packet. The owner keeps it, and the buffers it points to,
+ * alive until the transaction is done.
+ */
+typedef struct txq_entry {
+    struct txq_entry *next;
+    pkt_hdr_t        *hdr;
+    uint8_t          *buf;
+    lpmac_priority_t  priority;
+    bool              forward; // A mesh forward, owned by the MAC
+    bool              ok;      // Result, valid once done is posted
+    uint32_t          queued;  // Clock ticks when pushed
+    Semaphore_Struct  done;    // Posted when the transaction finishes
+} txq_entry_t;
+
+void lpmac_txq_init();
+bool lpmac_txq_push(txq_entry_t *entry);
+txq_entry_t *lpmac_txq_pop();
+
+#endif /* LPMAC_LPMAC_TXQ_H_ */
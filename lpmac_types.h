@@ -22,6 +22,11 @@
 #define EVENT_CADDONE_DETECT   Event_Id_05
 #define EVENT_CADDONE_NODETECT Event_Id_06
 #define EVENT_TIMEOUT          Event_Id_07
+#define EVENT_HOP              Event_Id_08
+#define EVENT_WAKE             Event_Id_09
+#define EVENT_CTS              Event_Id_18
+#define EVENT_NEIGHBORS        Event_Id_19
+#define EVENT_ADVERT           Event_Id_20
 
 /* High Level Events */
 #define EVENT_JOIN             Event_Id_10
@@ -31,6 +36,7 @@
 #define EVENT_SENDDONE_OK      Event_Id_14
 #define EVENT_SENDDONE_FAIL    Event_Id_15
 #define EVENT_RECV             Event_Id_16
+#define EVENT_BEACON           Event_Id_17
 
 #define LPMAC_SYNCWORD       0xD0
 
@@ -38,7 +44,13 @@ enum pkt_type {
     PKT_TYPE_ACK    = 1,
     PKT_TYPE_JOIN   = 2,
     PKT_TYPE_UNJOIN = 3,
-    PKT_TYPE_DATA   = 4
+    PKT_TYPE_DATA   = 4,
+    PKT_TYPE_BEACON = 5,
+    PKT_TYPE_RTS    = 6,
+    PKT_TYPE_CTS    = 7,
+    PKT_TYPE_BCAST      = 8, // A reliable broadcast symbol, see lpmac_bcast.h
+    PKT_TYPE_BCAST_POLL = 9,
+    PKT_TYPE_BCAST_NACK = 10
 };
 
 enum trans_state {
@@ -55,6 +67,12 @@ enum trans_state {
 
 #define PKT_OPTIONS_NO_ACK 0
 #define PKT_OPTIONS_REQ_ACK 1
+#define PKT_OPTIONS_MESH    2 // A pkt_mesh_ext follows the dst list
+#define PKT_OPTIONS_PRIO_SHIFT 2 // Priority class, kept when forwarding
+#define PKT_OPTIONS_PRIO_MASK  (3 << PKT_OPTIONS_PRIO_SHIFT)
+#define PKT_OPTIONS_PRIO(opts) ((lpmac_priority_t) (((opts) & PKT_OPTIONS_PRIO_MASK) >> PKT_OPTIONS_PRIO_SHIFT))
+#define PKT_OPTIONS_COMPRESSED 16 // The DATA payload is a pkt_compress_ext and an LZSS stream
+#define PKT_OPTIONS_BUSY       32 // On an ACK: heard, but no receive buffer was free, send again later
 
 /**
  * This is the states for a transaction with one
@@ -76,8 +94,38 @@ struct pkt_hdr {
 } __attribute__((__packed__));
 typedef struct pkt_hdr pkt_hdr_t;
 
+/** The payload of RTS and CTS packets, the time in ms the medium is reserved for */
+typedef uint16_t rts_duration_t;
+
+/**
+ * Multi-hop extension, present when PKT_OPTIONS_MESH is set.
+ * In a mesh packet, src and dst[0] name the current hop,
+ * while origin and final_dst name the end points.
+ */
+struct pkt_mesh_ext {
+    node_id_t     origin    : 32;
+    node_id_t     final_dst : 32;
+    uint8_t       seq       : 8; // The origin's pkt_id, used to drop duplicates
+    uint8_t       hops_left : 8;
+} __attribute__((__packed__));
+typedef struct pkt_mesh_ext pkt_mesh_ext_t;
+
+/**
+ * Starts the payload of DATA packets with PKT_OPTIONS_COMPRESSED set.
+ * A non zero dict names the last frame exchanged between the two hops,
+ * which the stream may refer back into.
+ */
+struct pkt_compress_ext {
+    uint8_t       size : 8; // The payload size once decompressed
+    uint16_t      dict : 16;
+} __attribute__((__packed__));
+typedef struct pkt_compress_ext pkt_compress_ext_t;
+
 #define PKT_HDR_CALC_SIZE(dst_count) (sizeof(struct pkt_hdr) + (sizeof(node_id_t)*(dst_count)))
-#define PKT_HDR_SIZE(pkt_hdr_ptr) (sizeof(struct pkt_hdr) + (sizeof(node_id_t)*((size_t)((pkt_hdr_ptr)->dst_count))))
+#define PKT_MESH_HDR_CALC_SIZE(dst_count) (PKT_HDR_CALC_SIZE(dst_count) + sizeof(struct pkt_mesh_ext))
+#define PKT_EXT_SIZE(pkt_hdr_ptr) ( ((pkt_hdr_ptr)->pkt_opts & PKT_OPTIONS_MESH) ? sizeof(struct pkt_mesh_ext) : 0 )
+#define PKT_MESH_EXT_PTR(pkt_hdr_ptr) ( (pkt_mesh_ext_t *)(((uint8_t *)(pkt_hdr_ptr)) + PKT_HDR_CALC_SIZE((pkt_hdr_ptr)->dst_count)) )
+#define PKT_HDR_SIZE(pkt_hdr_ptr) (sizeof(struct pkt_hdr) + (sizeof(node_id_t)*((size_t)((pkt_hdr_ptr)->dst_count))) + PKT_EXT_SIZE(pkt_hdr_ptr))
 #define PKT_DATA_PTR(pkt_hdr_ptr) ( ((uint8_t *)(pkt_hdr_ptr)) + PKT_HDR_SIZE(pkt_hdr_ptr) )
 #define PKT_SIZE(pkt_hdr_ptr) ( PKT_HDR_SIZE(pkt_hdr_ptr) + (pkt_hdr_ptr)->data_size )
 #define PKT_PAYLOAD_MAX_SIZE(dst_count) ( 256 - (sizeof(struct pkt_hdr) + (sizeof(node_id_t)*(dst_count))) )
@@ -0,0 +1,124 @@
+-- Wireshark dissector for LPMAC frames captured by tools/lpmac_trace.py
+--
+-- Copy into your Wireshark plugins directory, or run
+--     wireshark -X lua_script:tools/lpmac.lua trace.pcap
+--
+-- @author Craig Hesling <craig@hesling.com>
+-- @date Oct 18, 2026
+
+local lpmac = Proto("lpmac", "LoRa Peer MAC")
+
+local pkt_types = {
+    [1] = "ACK", [2] = "JOIN", [3] = "UNJOIN", [4] = "DATA",
+    [5] = "BEACON", [6] = "RTS", [7] = "CTS", [8] = "BCAST",
+    [9] = "BCAST POLL", [10] = "BCAST NACK",
+}
+local priorities = { [0] = "Control", [1] = "Urgent", [2] = "Normal", [3] = "Bulk" }
+local directions = { [0] = "TX", [1] = "RX" }
+
+-- Must match PKT_OPTIONS_* in lpmac_types.h
+local OPT_REQ_ACK = 0x01
+local OPT_MESH    = 0x02
+local OPT_COMPRESSED = 0x10
+local OPT_BUSY    = 0x20
+
+local f = lpmac.fields
+f.direction = ProtoField.uint8("lpmac.direction", "Direction", base.DEC, directions)
+f.snr       = ProtoField.int8("lpmac.snr", "SNR")
+f.rssi      = ProtoField.int16("lpmac.rssi", "RSSI")
+f.pkt_type  = ProtoField.uint8("lpmac.type", "Type", base.DEC, pkt_types)
+f.pkt_opts  = ProtoField.uint8("lpmac.opts", "Options", base.HEX)
+f.req_ack   = ProtoField.bool("lpmac.opts.req_ack", "ACK Requested", 8, nil, OPT_REQ_ACK)
+f.mesh      = ProtoField.bool("lpmac.opts.mesh", "Mesh", 8, nil, OPT_MESH)
+f.priority  = ProtoField.uint8("lpmac.opts.priority", "Priority", base.DEC, priorities, 0x0C)
+f.compressed = ProtoField.bool("lpmac.opts.compressed", "Compressed", 8, nil, OPT_COMPRESSED)
+f.busy      = ProtoField.bool("lpmac.opts.busy", "Busy", 8, nil, OPT_BUSY)
+f.pkt_id    = ProtoField.uint8("lpmac.id", "Packet ID")
+f.dst_count = ProtoField.uint8("lpmac.dst_count", "Destination Count")
+f.data_size = ProtoField.uint8("lpmac.data_size", "Data Size")
+f.src       = ProtoField.uint32("lpmac.src", "Source", base.HEX)
+f.dst       = ProtoField.uint32("lpmac.dst", "Destination", base.HEX)
+f.origin    = ProtoField.uint32("lpmac.mesh.origin", "Origin", base.HEX)
+f.final_dst = ProtoField.uint32("lpmac.mesh.final_dst", "Final Destination", base.HEX)
+f.seq       = ProtoField.uint8("lpmac.mesh.seq", "Sequence")
+f.hops_left = ProtoField.uint8("lpmac.mesh.hops_left", "Hops Left")
+f.duration  = ProtoField.uint16("lpmac.nav", "Reserved ms")
+f.plain_size = ProtoField.uint8("lpmac.compress.size", "Decompressed Size")
+f.dict      = ProtoField.uint16("lpmac.compress.dict", "Dictionary", base.HEX)
+f.data      = ProtoField.bytes("lpmac.data", "Data")
+
+function lpmac.dissector(buf, pinfo, root)
+    pinfo.cols.protocol = "LPMAC"
+    local tree = root:add(lpmac, buf())
+
+    -- Pseudo header written by lpmac_trace.py
+    local direction = buf(0, 1):uint()
+    tree:add(f.direction, buf(0, 1))
+    if direction == 1 then
+        tree:add(f.snr, buf(1, 1))
+        tree:add_le(f.rssi, buf(2, 2))
+    end
+
+    -- struct pkt_hdr
+    local hdr = buf(4)
+    if hdr:len() < 9 then
+        pinfo.cols.info = "Truncated"
+        return
+    end
+    local pkt_type = hdr(0, 1):uint()
+    local opts = hdr(1, 1):uint()
+    local dst_count = hdr(3, 1):uint()
+    local data_size = hdr(4, 1):uint()
+    tree:add(f.pkt_type, hdr(0, 1))
+    local opts_tree = tree:add(f.pkt_opts, hdr(1, 1))
+    opts_tree:add(f.req_ack, hdr(1, 1))
+    opts_tree:add(f.mesh, hdr(1, 1))
+    opts_tree:add(f.priority, hdr(1, 1))
+    opts_tree:add(f.compressed, hdr(1, 1))
+    opts_tree:add(f.busy, hdr(1, 1))
+    tree:add(f.pkt_id, hdr(2, 1))
+    tree:add(f.dst_count, hdr(3, 1))
+    tree:add(f.data_size, hdr(4, 1))
+    tree:add_le(f.src, hdr(5, 4))
+
+    local offset = 9
+    local dsts = {}
+    for i = 1, dst_count do
+        if offset + 4 > hdr:len() then
+            break
+        end
+        tree:add_le(f.dst, hdr(offset, 4))
+        dsts[#dsts + 1] = string.format("%08X", hdr(offset, 4):le_uint())
+        offset = offset + 4
+    end
+
+    if bit.band(opts, OPT_MESH) ~= 0 and offset + 10 <= hdr:len() then
+        local mesh = tree:add(hdr(offset, 10), "Mesh Extension")
+        mesh:add_le(f.origin, hdr(offset, 4))
+        mesh:add_le(f.final_dst, hdr(offset + 4, 4))
+        mesh:add(f.seq, hdr(offset + 8, 1))
+        mesh:add(f.hops_left, hdr(offset + 9, 1))
+        offset = offset + 10
+    end
+
+    if data_size > 0 and offset < hdr:len() then
+        local data = hdr(offset)
+        if (pkt_type == 6 or pkt_type == 7) and data:len() >= 2 then
+            tree:add_le(f.duration, data(0, 2))
+        elseif pkt_type == 4 and bit.band(opts, OPT_COMPRESSED) ~= 0 and data:len() > 3 then
+            local ext = tree:add(data(0, 3), "Compression Extension")
+            ext:add(f.plain_size, data(0, 1))
+            ext:add_le(f.dict, data(1, 2))
+            tree:add(f.data, data(3))
+        else
+            tree:add(f.data, data)
+        end
+    end
+
+    pinfo.cols.info = string.format("%s %s id=%d %08X -> %s",
+        directions[direction] or "?", pkt_types[pkt_type] or tostring(pkt_type),
+        hdr(2, 1):uint(), hdr(5, 4):le_uint(),
+        (#dsts == 0) and "broadcast" or table.concat(dsts, ","))
+end
+
+DissectorTable.get("wtap_encap"):add(wtap.USER0, lpmac)
@@ -0,0 +1,230 @@
+#!/usr/bin/env python3
+"""Convert an LPMAC trace dump into a pcap or a Chrome trace.
+
+Capture the serial console while calling LPMAC_TraceDump(), then:
+
+    lpmac_trace.py pcap console.log trace.pcap
+    lpmac_trace.py chrome console.log trace.json
+
+The pcap uses DLT_USER0 (147). Load tools/lpmac.lua in Wireshark to
+dissect it. Every packet starts with a 4 byte pseudo header:
+
+    uint8  direction  0 = TX, 1 = RX
+    int8   snr        dB, RX only
+    int16  rssi       dBm, little endian, RX only
+
+followed by the first TRACE_CAPTURE_MAX bytes of the frame.
+
+The Chrome trace opens in Perfetto (ui.perfetto.dev) or chrome://tracing.
+
+@author Craig Hesling <craig@hesling.com>
+@date Oct 18, 2026
+"""
+
+import argparse
+import json
+import re
+import struct
+import sys
+
+# Must match trace_event_t in lpmac_trace.h
+TRACE_STATE = 0
+TRACE_BACKOFF = 1
+TRACE_CAD_START = 2
+TRACE_CAD_DONE = 3
+TRACE_TX_START = 4
+TRACE_TX_DONE = 5
+TRACE_RX = 6
+TRACE_RX_DROP = 7
+TRACE_RX_TIMEOUT = 8
+TRACE_SEND_START = 9
+TRACE_SEND_DONE = 10
+TRACE_ACK = 11
+TRACE_TIMEOUT = 12
+
+# Must match trace_state_t in lpmac_trace.h
+STATES = {0: "SLEEP", 1: "STANDBY", 2: "RX"}
+
+# Must match lpmac_stat_t in lpmac.h
+DROP_REASONS = {
+    13: "crc",
+    14: "runt",
+    15: "size",
+    16: "filter",
+    17: "duplicate",
+    18: "no route",
+    19: "queue full",
+    20: "rx full",
+    21: "decompress",
+}
+
+PKT_TYPES = {1: "ACK", 2: "JOIN", 3: "UNJOIN", 4: "DATA", 5: "BEACON", 6: "RTS", 7: "CTS",
+             8: "BCAST", 9: "BCAST_POLL", 10: "BCAST_NACK"}
+
+FORMAT_VERSION = 1
+DLT_USER0 = 147
+
+LINE_RE = re.compile(r"TRACE (BEGIN|END|\d+)((?: \S+)*)")
+
+
+class Record(object):
+    def __init__(self, time_us, event, size, arg0, arg1, frame):
+        self.time_us = time_us
+        self.event = event
+        self.size = size
+        self.arg0 = arg0
+        self.arg1 = arg1
+        self.frame = frame
+
+
+def parse(lines):
+    """Yield the records of every dump in lines, with times in microseconds"""
+    tick_us = None
+    last_ticks = None
+    wraps = 0
+    for line in lines:
+        match = LINE_RE.search(line)
+        if match is None:
+            continue
+        fields = match.group(2).split()
+        if match.group(1) == "BEGIN":
+            version, tick_us = int(fields[0]), int(fields[1])
+            if version != FORMAT_VERSION:
+                raise ValueError("Unsupported trace format version %d" % version)
+            continue
+        if match.group(1) == "END":
+            if int(fields[0]) > 0:
+                sys.stderr.write("Warning: %s records were overwritten before the dump\n"
+                                 % fields[0])
+            continue
+        if tick_us is None:
+            raise ValueError("Trace record before TRACE BEGIN")
+
+        ticks = int(match.group(1))
+        if last_ticks is not None and ticks < last_ticks:
+            # Clock_getTicks() wrapped
+            wraps += 1
+        last_ticks = ticks
+        frame = bytes.fromhex(fields[4]) if len(fields) > 4 else b""
+        yield Record(((wraps << 32) + ticks) * tick_us,
+                     int(fields[0]), int(fields[1]), int(fields[2]), int(fields[3]), frame)
+
+
+def write_pcap(records, out):
+    out.write(struct.pack("<IHHiIII", 0xA1B2C3D4, 2, 4, 0, 0, 0xFFFF, DLT_USER0))
+    for record in records:
+        if record.event == TRACE_TX_START:
+            pseudo = struct.pack("<Bbh", 0, 0, 0)
+        elif record.event == TRACE_RX:
+            pseudo = struct.pack("<Bbh", 1, max(-128, min(127, record.arg1)), record.arg0)
+        else:
+            continue
+        data = pseudo + record.frame
+        out.write(struct.pack("<IIII", record.time_us // 1000000, record.time_us % 1000000,
+                              len(data), len(pseudo) + record.size))
+        out.write(data)
+
+
+def frame_summary(frame):
+    """Describe the start of a frame, following struct pkt_hdr"""
+    if len(frame) < 9:
+        return {}
+    pkt_type, pkt_opts, pkt_id, dst_count, data_size, src = struct.unpack_from("<BBBBBI", frame)
+    return {
+        "type": PKT_TYPES.get(pkt_type, pkt_type),
+        "opts": pkt_opts,
+        "pkt_id": pkt_id,
+        "src": "%8.8X" % src,
+        "dst_count": dst_count,
+        "data_size": data_size,
+    }
+
+
+def chrome_events(records):
+    tid_radio, tid_mac, tid_events = 1, 2, 3
+    events = [
+        {"ph": "M", "pid": 1, "name": "process_name", "args": {"name": "LPMAC"}},
+        {"ph": "M", "pid": 1, "tid": tid_radio, "name": "thread_name", "args": {"name": "Radio"}},
+        {"ph": "M", "pid": 1, "tid": tid_mac, "name": "thread_name", "args": {"name": "Transactions"}},
+        {"ph": "M", "pid": 1, "tid": tid_events, "name": "thread_name", "args": {"name": "Events"}},
+    ]
+    radio = None  # (name, start, args) of the open radio slice
+    sends = {}    # pkt_id -> (start, args)
+
+    def radio_enter(name, time_us, args=None):
+        nonlocal radio
+        if radio is not None:
+            events.append({"ph": "X", "pid": 1, "tid": tid_radio, "name": radio[0],
+                           "ts": radio[1], "dur": time_us - radio[1], "args": radio[2]})
+        radio = (name, time_us, args or {})
+
+    def instant(name, time_us, args):
+        events.append({"ph": "i", "s": "t", "pid": 1, "tid": tid_events, "name": name,
+                       "ts": time_us, "args": args})
+
+    for record in records:
+        t = record.time_us
+        if record.event == TRACE_STATE:
+            radio_enter(STATES.get(record.arg0, "STATE %d" % record.arg0), t)
+        elif record.event == TRACE_CAD_START:
+            radio_enter("CAD", t)
+        elif record.event == TRACE_CAD_DONE:
+            radio_enter("SLEEP", t)
+            instant("CAD busy" if record.arg0 else "CAD clear", t, {})
+        elif record.event == TRACE_TX_START:
+            radio_enter("TX", t, frame_summary(record.frame))
+        elif record.event == TRACE_TX_DONE:
+            radio_enter("SLEEP", t)
+            if record.arg0:
+                instant("TX timeout", t, {})
+        elif record.event == TRACE_BACKOFF:
+            events.append({"ph": "X", "pid": 1, "tid": tid_mac, "name": "backoff",
+                           "ts": t, "dur": record.arg0 * 1000, "args": {"ms": record.arg0}})
+        elif record.event == TRACE_RX:
+            args = frame_summary(record.frame)
+            args.update({"rssi": record.arg0, "snr": record.arg1, "size": record.size})
+            instant("RX", t, args)
+        elif record.event == TRACE_RX_DROP:
+            instant("RX drop", t, {"reason": DROP_REASONS.get(record.arg0, record.arg0)})
+        elif record.event == TRACE_RX_TIMEOUT:
+            instant("RX timeout", t, {})
+        elif record.event == TRACE_SEND_START:
+            sends[record.arg0] = (t, {"pkt_id": record.arg0, "priority": record.arg1})
+        elif record.event == TRACE_SEND_DONE:
+            start = sends.pop(record.arg0, None)
+            if start is not None:
+                args = dict(start[1], ok=bool(record.arg1))
+                events.append({"ph": "X", "pid": 1, "tid": tid_mac,
+                               "name": "send %d" % record.arg0,
+                               "ts": start[0], "dur": t - start[0], "args": args})
+        elif record.event == TRACE_ACK:
+            instant("ACK", t, {"pkt_id": record.arg0, "attempts": record.arg1})
+        elif record.event == TRACE_TIMEOUT:
+            instant("Timeout", t, {"pkt_id": record.arg0, "retries": record.arg1})
+    if radio is not None:
+        radio_enter(None, t)
+    return events
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n")[0])
+    parser.add_argument("format", choices=["pcap", "chrome"])
+    parser.add_argument("log", help="Console capture containing TRACE lines, - for stdin")
+    parser.add_argument("output")
+    args = parser.parse_args()
+
+    source = sys.stdin if args.log == "-" else open(args.log, errors="replace")
+    with source:
+        records = list(parse(source))
+
+    if args.format == "pcap":
+        with open(args.output, "wb") as out:
+            write_pcap(records, out)
+    else:
+        with open(args.output, "w") as out:
+            json.dump({"traceEvents": chrome_events(records),
+                       "displayTimeUnit": "ms"}, out, indent=1)
+
+
+if __name__ == "__main__":
+    main()